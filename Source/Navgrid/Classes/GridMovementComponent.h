@@ -3,9 +3,12 @@
 #pragma once
 
 #include "GameFramework/PawnMovementComponent.h"
+#include "GridPathSamples.h"
 #include "GridMovementComponent.generated.h"
 
 class ANavGrid;
+class ANavGridGameState;
+class UGridMovementSubsystem;
 class USplineComponent;
 class USplineMeshComponent;
 class UStaticMesh;
@@ -21,14 +24,64 @@ enum class EGridMovementMode : uint8
 	InPlaceTurn     UMETA(DisplayName = "Turn in place"),
 };
 
+/**
+* A set of EGridMovementModes stored as one bit per mode.
+*
+* Checked for every tile a search expands, so it must not allocate. Use ToSet() and the TSet constructor
+* where a TSet is more convenient, e.g. in Blueprint accessors.
+*/
+USTRUCT(BlueprintType)
+struct NAVGRID_API FGridMovementModes
+{
+	GENERATED_BODY()
+	FGridMovementModes() {}
+	FGridMovementModes(std::initializer_list<EGridMovementMode> InModes);
+	explicit FGridMovementModes(const TSet<EGridMovementMode> &InModes);
+
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (Bitmask, BitmaskEnum = "EGridMovementMode"))
+	int32 Mask = 0;
+
+	static int32 GetBit(EGridMovementMode Mode) { return 1 << (uint8)Mode; }
+	bool Contains(EGridMovementMode Mode) const { return (Mask & GetBit(Mode)) != 0; }
+	/* Is there at least one mode in both sets */
+	bool Overlaps(const FGridMovementModes &Other) const { return (Mask & Other.Mask) != 0; }
+	bool IsEmpty() const { return Mask == 0; }
+	void Add(EGridMovementMode Mode) { Mask |= GetBit(Mode); }
+	void Remove(EGridMovementMode Mode) { Mask &= ~GetBit(Mode); }
+	void Empty() { Mask = 0; }
+	TSet<EGridMovementMode> ToSet() const;
+
+	bool operator==(const FGridMovementModes &Other) const { return Mask == Other.Mask; }
+	bool operator!=(const FGridMovementModes &Other) const { return Mask != Other.Mask; }
+};
+
+/**
+* Version of the data NavGrid components save. Used to convert data saved by older versions of the plugin in PostLoad()
+*/
+struct NAVGRID_API FNavGridCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		/* Movement modes are saved as FGridMovementModes instead of TSet<EGridMovementMode> */
+		MovementModeFlags,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+	static const FGuid GUID;
+	/* Should Object convert data saved before Version? Only true for objects that are loaded from a package, duplicates are copied from converted data */
+	static bool NeedsConversion(const UObject &Object, Type Version);
+};
+
 USTRUCT()
 struct FPathSegment
 {
 	GENERATED_BODY()
 	FPathSegment() {}
-	FPathSegment(TSet<EGridMovementMode> InMovementModes, float InStart, float InEnd);
+	FPathSegment(const FGridMovementModes &InMovementModes, float InStart, float InEnd);
 	/* Legal movement modes for this segment */
-	TSet<EGridMovementMode> MovementModes;
+	FGridMovementModes MovementModes;
 	/* start and end distance along the path spline this segment covers */
 	float Start, End;
 	FRotator PawnRotationHint;
@@ -45,8 +98,25 @@ class NAVGRID_API UGridMovementComponent : public UPawnMovementComponent
 public:
 	UGridMovementComponent(const FObjectInitializer &ObjectInitializer);
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Serialize(FArchive &Ar) override;
+	virtual void PostLoad() override;
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
 	virtual void StopMovementImmediately() override;
+	/* Move or turn the pawn for one frame. Called by UGridMovementSubsystem, or from TickComponent() if there is no subsystem */
+	void TickMovement(float DeltaTime);
+
+private:
+	friend class UGridMovementSubsystem;
+	/* True if there is nothing to do until we are told to move or turn */
+	bool CanSleep() const;
+	/* Called when UGridMovementSubsystem stops ticking us */
+	void Sleep();
+	/* Start ticking if we are not already */
+	void Wake();
+	/* Our index in UGridMovementSubsystem::ActiveMovers, INDEX_NONE while we are asleep */
+	int32 ActiveMoverIndex = INDEX_NONE;
+	TWeakObjectPtr<UGridMovementSubsystem> MovementSubsystem;
 
 protected:
 	/* return an transform usable for following the spline path */
@@ -54,11 +124,28 @@ protected:
 	/* return an tranfrom usable for rotation in place */
 	FTransform TransformFromRotation(float DeltaTime);
 public:
+	/* Find the tile we are on with GetTile(). While moving along a path, UpdateCurrentTileFromPath() is used instead */
 	void ConsiderUpdateCurrentTile();
 protected:
+	/* Set CurrentTile from the tiles along the path and the distance we have moved, without looking anything up in the grid */
+	void UpdateCurrentTileFromPath();
+	/* Bound to the TransformUpdated event of the owner's root. Looks up CurrentTile again when something else moved the pawn, e.g. a teleport */
+	void OnOwnerTransformUpdated(USceneComponent *UpdatedRoot, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	/* Set while we move the owner ourselves, CurrentTile is kept up to date by the path then */
+	bool bMovingOwner = false;
+	FDelegateHandle OwnerTransformUpdatedHandle;
+	/* Change CurrentTile and tell ANavGridGameState about it */
+	void SetCurrentTile(UNavTileComponent *Tile);
 	/* The tile we're currently on */
 	UPROPERTY()
 	UNavTileComponent *CurrentTile = NULL;
+	/* Every tile along the current path, in order, before string pulling. The pawn enters PathTiles[N] at PathTileEnterDistances[N] */
+	UPROPERTY()
+	TArray<UNavTileComponent *> PathTiles;
+	TArray<float> PathTileEnterDistances;
+	/* Next entry in PathTiles that we have not entered yet */
+	int32 PathTileCursor = 0;
+	TWeakObjectPtr<ANavGridGameState> CachedGameState;
 	FPathSegment CurrentPathSegment;
 public:
 
@@ -66,6 +153,10 @@ public:
 	void GetTilesInRange(TArray<UNavTileComponent *> &OutTiles);
 	/* Get the tile the pawn is on, returns NULL if the pawn is not on a tile */
 	UNavTileComponent *GetTile();
+	/* The tile we were on when it was last looked up, without looking it up again */
+	UNavTileComponent *GetCachedTile() const { return CurrentTile; }
+	/* Every tile along the current path, empty if we are not following one */
+	const TArray<UNavTileComponent *> &GetPathTiles() const { return PathTiles; }
 	ANavGrid *GetNavGrid();
 	/* How far (in tile cost) the actor can move in one go */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Movement")
@@ -81,7 +172,14 @@ public:
 	float MaxRotationSpeed = 720;
 	/* MovementModes usable for this Pawn */
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Movement")
-	TSet<EGridMovementMode> AvailableMovementModes;
+	FGridMovementModes AvailableMovementModeFlags;
+	/* Saved before AvailableMovementModeFlags existed. Converted in PostLoad(), see FNavGridCustomVersion::MovementModeFlags */
+	UPROPERTY()
+	TSet<EGridMovementMode> AvailableMovementModes_DEPRECATED;
+	UFUNCTION(BlueprintPure, Category = "Movement")
+	TSet<EGridMovementMode> GetAvailableMovementModes() const { return AvailableMovementModeFlags.ToSet(); }
+	UFUNCTION(BlueprintCallable, Category = "Movement")
+	void SetAvailableMovementModes(const TSet<EGridMovementMode> &InMovementModes) { AvailableMovementModeFlags = FGridMovementModes(InMovementModes); }
 	/* Should we ignore rotation over the X axis */
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Movement")
 	bool LockRoll = true;
@@ -98,6 +196,10 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Movement")
 	bool bAlwaysUseRootMotion = false;
 
+	/* Jump straight to the end of the path instead of following it, and turn instantly. Used for headless simulations */
+	UPROPERTY(BlueprintReadWrite, EditAnyWhere, Category = "Movement")
+	bool bInstantMovement = false;
+
 	/* Should we straighten out the path to avoid zigzaging */
 	UPROPERTY(BlueprintReadWrite, EditAnyWhere, Category = "Movement")
 	bool bStringPullPath = true;
@@ -117,14 +219,24 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Visualization")
 	float HorizontalOffset = 87.5;
 
-	/* Create a path to TargetTile, return false if no path is found */
+	/* Create a path to TargetTile, return false if no path is found within MovementRange. Only uses the virtual tiles placed so far, MoveTo() places the rest first */
 	bool CreatePath(const UNavTileComponent &Target);
+	/* Create a path to TargetTile that costs at most MaxCost. Use a negative MaxCost for no limit */
+	bool CreatePath(const UNavTileComponent &Target, float MaxCost);
+	/* Build the path spline from a list of tiles, starting with the tile we are on */
+	bool CreatePathFromTiles(TArray<const UNavTileComponent *> Path);
 	/* Create a path and follow it if it exists */
 	bool MoveTo(const UNavTileComponent &Target);
+	/* Move as far as we can this turn along a route to Target that may take several turns. See ANavGrid::PlanRoute() */
+	bool MoveTowards(UNavTileComponent &Target);
 	/* Turn in place */
 	void TurnTo(const FRotator &Forward);
 	/* Snap actor the grid */
 	void SnapToGrid();
+protected:
+	/* Move to the last tile in PathTiles and finish movement, used when bInstantMovement is set */
+	void JumpToPathEnd();
+public:
 	/* Advance a given distance along the path */
 	void AdvanceAlongPath(float InDistance);
 	/* Get the remaining distance of the current path (zero if the pawn is currently not moving) */
@@ -134,9 +246,9 @@ public:
 protected:
 	FRotator DesiredForwardRotation;
 public:
-	/* Visualize path */
+	/* Visualize path, replacing the path that is currently shown */
 	void ShowPath();
-	/* Hide path */
+	/* Hide path. The spline meshes are kept for the next call to ShowPath() */
 	void HidePath();
 
 	FTransform ConsumeRootMotion();
@@ -165,10 +277,12 @@ private:
 	FOnMovementModeChanged OnMovementModeChangedEvent;
 
 protected:
+	/* Pool of spline meshes used by ShowPath(). The first NumVisibleSplineMeshes are in use, the rest are hidden */
 	UPROPERTY()
 	TArray<USplineMeshComponent *> SplineMeshes;
+	int32 NumVisibleSplineMeshes = 0;
 
-	/* Helper: Puts a spline mesh in the range along the spline */
+	/* Helper: Puts a spline mesh in the range along the spline, reusing a hidden one from the pool if there is one */
 	void AddSplineMesh(float From, float To);
 
 	/* How far along the spline are we */
@@ -190,4 +304,12 @@ protected:
 
 	UPROPERTY()
 	TArray<FPathSegment> PathSegments;
+	/* Index in PathSegments to start looking for CurrentPathSegment from, as Distance never decreases along a path */
+	int32 PathSegmentCursor = 0;
+	/* Spline sampled when the path is created. Moving along the path only reads from this */
+	FGridPathSamples PathSamples;
+public:
+	/* Distance between the samples used when moving along a path */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Movement", meta = (ClampMin = 1))
+	float PathSampleSpacing = 10;
 };
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "GridMovementSubsystem.generated.h"
+
+class UGridMovementComponent;
+class UGridMovementSubsystem;
+
+/**
+* Tick function that runs UGridMovementSubsystem::Tick() in the tick group movement components tick in
+*/
+USTRUCT()
+struct NAVGRID_API FGridMovementTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UGridMovementSubsystem *Target = nullptr;
+
+	// FTickFunction
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGridMovementTickFunction> : public TStructOpsTypeTraitsBase2<FGridMovementTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+* Ticks every UGridMovementComponent in the world that is moving, in a single pass.
+*
+* Movement components do not tick by themselves. They are woken up when they start moving or turning
+* (see UGridMovementComponent::ChangeMovementMode()) and are put back to sleep once they are stationary,
+* so idle pawns cost nothing per frame.
+*
+* The batch runs from a registered tick function in the same tick group as the components would tick in, and each
+* mover is ticked with its owner's CustomTimeDilation applied.
+*/
+UCLASS()
+class NAVGRID_API UGridMovementSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	UGridMovementSubsystem();
+
+	/* Start ticking Component. Does nothing if it is already awake */
+	void Wake(UGridMovementComponent &Component);
+	/* Stop ticking Component, e.g. because it is being destroyed */
+	void Remove(UGridMovementComponent &Component);
+	int32 GetNumActiveMovers() const { return ActiveMovers.Num(); }
+
+	/* Tick every awake mover. Called by TickFunction while there are any */
+	void Tick(float DeltaTime);
+
+	// UWorldSubsystem
+	virtual void Deinitialize() override;
+
+protected:
+	/* Movement components that are awake, each one knows its own index (UGridMovementComponent::ActiveMoverIndex). Removed entries are NULL until the next tick */
+	UPROPERTY(Transient)
+	TArray<UGridMovementComponent *> ActiveMovers;
+	/* Registered with the persistent level the first time a mover wakes up, and only enabled while someone is awake */
+	FGridMovementTickFunction TickFunction;
+};
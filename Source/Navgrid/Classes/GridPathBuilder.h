@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SplineComponent.h"
+#include "GridMovementComponent.h"
+
+/**
+* Spline points and path segments gathered while building a path, see UNavTileComponent::AddPathSegments().
+*
+* Adding points to a USplineComponent one at a time rebuilds its reparam table every time, and the length of
+* the spline is needed for the segments after every point. Instead, segments refer to points by index, and
+* the spline and segment distances are all computed by a single call to Build().
+*/
+class NAVGRID_API FGridPathBuilder
+{
+public:
+	/* Add a point to the end of the path and return its index */
+	int32 AddPoint(const FVector &Location, ESplinePointType::Type Type = ESplinePointType::Curve);
+	void SetPointLocation(int32 PointIndex, const FVector &Location) { Points[PointIndex] = Location; }
+	int32 GetNumPoints() const { return Points.Num(); }
+	const FVector &GetLastPoint() const { return Points.Last(); }
+
+	/* Add a segment covering the path from StartPoint to EndPoint. Start and End of Segment are ignored */
+	void AddSegment(const FPathSegment &Segment, int32 StartPoint, int32 EndPoint);
+	int32 GetNumSegments() const { return Segments.Num(); }
+	/* Make the last segment end at EndPoint instead */
+	void SetLastSegmentEnd(int32 EndPoint) { SegmentPoints.Last().Value = EndPoint; }
+
+	/* Replace the points of OutSpline with the gathered points, and the segments in OutSegments with the gathered segments */
+	void Build(USplineComponent &OutSpline, TArray<FPathSegment> &OutSegments) const;
+	void Reset();
+
+private:
+	TArray<FVector> Points;
+	TArray<ESplinePointType::Type> PointTypes;
+	TArray<FPathSegment> Segments;
+	/* First and last point of each segment */
+	TArray<TPair<int32, int32>> SegmentPoints;
+};
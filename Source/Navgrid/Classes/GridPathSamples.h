@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+/**
+* Positions and rotations along a path spline, sampled at a fixed spacing when the path is created.
+*
+* Evaluating a USplineComponent at a distance searches its reparam table and evaluates the curve, which
+* adds up when many pawns move at the same time. Looking up a distance in the table is a division and a
+* lerp between two samples.
+*/
+class NAVGRID_API FGridPathSamples
+{
+public:
+	/* Sample Spline every SampleSpacing units */
+	void Build(const USplineComponent &Spline, float SampleSpacing);
+	void Reset();
+	bool IsEmpty() const { return Locations.Num() == 0; }
+	float GetLength() const { return Length; }
+
+	FVector GetLocation(float Distance) const;
+	FTransform GetTransform(float Distance) const;
+	/*
+	* Distance of the sample closest to Location, searching forward from sample InOutSample and stopping at the first
+	* local minimum. Use this to find where the path passes a series of locations in order
+	*/
+	float FindClosestDistance(const FVector &Location, int32 &InOutSample) const;
+
+private:
+	/* Index of the sample before Distance and how far along the next one Distance is */
+	void GetSampleAlpha(float Distance, int32 &OutIndex, float &OutAlpha) const;
+
+	TArray<FVector> Locations;
+	TArray<FQuat> Rotations;
+	float Spacing = 1;
+	float Length = 0;
+};
@@ -119,8 +119,14 @@ public:
 	/* can the we request to start our turn now? The turn manager may still deny our request even if this returns true */
 	virtual bool CanBeSelected();
 
+	/* Can we move to Tile this turn. Places every virtual tile within range first, so use it when committing to a move */
 	virtual bool CanMoveTo(const UNavTileComponent & Tile);
+	/* Like CanMoveTo(), but only uses the virtual tiles placed so far, so it is cheap enough to ask every time the cursor moves */
+	virtual bool CanMoveToProvisionally(const UNavTileComponent & Tile);
 	virtual void MoveTo(const UNavTileComponent & Tile);
+protected:
+	bool IsTileInMoveRange(const UNavTileComponent & Tile, bool bCompleteVirtualTiles);
+public:
 
 	/* get the tile occupied at the start of this pawns turn */
 	UFUNCTION(BlueprintCallable)
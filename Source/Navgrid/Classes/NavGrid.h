@@ -7,14 +7,113 @@
 
 #include "NavTileComponent.h"
 #include "GridMovementComponent.h"
+#include "NavGridSearchContext.h"
+#include "NavGridHierarchy.h"
+#include "NavGridRangeCache.h"
+#include "NavGridSnapshot.h"
 
 #include "NavGrid.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(NavGrid, Log, All);
+DECLARE_STATS_GROUP(TEXT("NavGrid"), STATGROUP_NavGrid, STATCAT_Advanced);
+
+class AGridPawn;
+class UNavGridBakedTiles;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTileClicked, const UNavTileComponent*, Tile);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTileCursorOver, const UNavTileComponent*, Tile);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndTileCursorOver, const UNavTileComponent*, Tile);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnVirtualTilesGenerated, const AGridPawn*, Pawn);
+
+/**
+* The shape of a movement collision capsule that tile edges have been baked for
+*/
+USTRUCT()
+struct FNavGridCapsuleProfile
+{
+	GENERATED_BODY()
+	UPROPERTY(VisibleAnywhere)
+	float Radius = 0;
+	UPROPERTY(VisibleAnywhere)
+	float HalfHeight = 0;
+	/* Capsule location relative to the pawn */
+	UPROPERTY(VisibleAnywhere)
+	FVector Offset = FVector::ZeroVector;
+
+	bool Matches(const UCapsuleComponent &Capsule) const;
+	bool Matches(const FNavGridCapsuleProfile &Other) const;
+};
+
+/**
+* How a highlight type is drawn when every type shares a single mesh, see ANavGrid::bSingleHighlightMesh
+*/
+USTRUCT(BlueprintType)
+struct NAVGRID_API FNavGridHighlightStyle
+{
+	GENERATED_BODY()
+	/* Per instance custom data 0-3 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Highlight")
+	FLinearColor Color = FLinearColor::White;
+	/* Per instance custom data 4, lets the material pick a pattern */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Highlight")
+	int32 Pattern = 0;
+};
+
+/**
+* A path that may take several turns to complete, split into legs that can each be completed in a single turn
+*/
+USTRUCT(BlueprintType)
+struct NAVGRID_API FNavGridRoute
+{
+	GENERATED_BODY()
+	/* Tiles along the route, starting with the tile the pawn is on */
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	TArray<UNavTileComponent *> Tiles;
+	/* Index in Tiles of the last tile of each leg */
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	TArray<int32> LegEnds;
+
+	int32 NumLegs() const { return LegEnds.Num(); }
+	/* Get the tiles for a single leg, including the tile the leg starts on */
+	void GetLeg(int32 Leg, TArray<const UNavTileComponent *> &OutTiles) const;
+	UNavTileComponent *GetDestination() const { return Tiles.Num() ? Tiles.Last() : nullptr; }
+};
+
+/**
+* Identifies a query started by ANavGrid::FindPathAsync() or ANavGrid::GetTilesInRangeAsync()
+*/
+USTRUCT(BlueprintType)
+struct NAVGRID_API FNavGridQueryHandle
+{
+	GENERATED_BODY()
+	UPROPERTY()
+	int32 Id = 0;
+
+	bool IsValid() const { return Id != 0; }
+	bool operator==(const FNavGridQueryHandle &Other) const { return Id == Other.Id; }
+};
+
+/**
+* Result of an asynchronous query
+*/
+USTRUCT(BlueprintType)
+struct NAVGRID_API FNavGridQueryResult
+{
+	GENERATED_BODY()
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	FNavGridQueryHandle Handle;
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	bool bSuccess = false;
+	/* The path, starting with the tile the pawn is on, for path queries. Every tile in range except the tile the pawn is on for range queries */
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	TArray<UNavTileComponent *> Tiles;
+	/* Cost of moving to each tile in Tiles */
+	UPROPERTY(BlueprintReadOnly, Category = "Pathfinding")
+	TArray<float> Distances;
+};
+
+DECLARE_DELEGATE_OneParam(FOnNavGridQueryDone, const FNavGridQueryResult &);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnNavGridQueryDoneDynamic, const FNavGridQueryResult &, Result);
 
 /**
  * A grid that pawns can move around on.
@@ -27,6 +126,9 @@ class NAVGRID_API ANavGrid : public AActor
 
 public:
 	ANavGrid();
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual void PostRegisterAllComponents() override;
 
 	/* Collision channel used when tracing for tiles */
 	static TEnumAsByte<ECollisionChannel> ECC_NavGridWalkable;
@@ -61,18 +163,78 @@ protected:
 	UPROPERTY()
 	TMap<FName, UInstancedStaticMeshComponent *> TileHighlights;
 	TMap<FName, const TCHAR *> TileHighLightPaths;
+	/* Tiles that have one highlight type */
+	struct FTileHighlightSet
+	{
+		/* Instance index of every highlighted tile */
+		TMap<const UNavTileComponent *, int32> Instances;
+		/* Tiles that should have this highlight after the next flush. Only valid while bDirty is set */
+		TSet<const UNavTileComponent *> Pending;
+		bool bDirty = false;
+	};
+	TMap<FName, FTileHighlightSet> HighlightSets;
+	/* Bookkeeping for the instances of one highlight mesh, which may be shared by several highlight types */
+	struct FHighlightInstances
+	{
+		/* Highlight type and tile shown by each instance, NULL tiles for instances that are no longer used */
+		TArray<TPair<FName, const UNavTileComponent *>> Owners;
+		/* Instances that are no longer used, they are reused or removed by the next flush */
+		TArray<int32> FreeInstances;
+	};
+	/* Keyed like TileHighlights, see GetHighlightMeshKey() */
+	TMap<FName, FHighlightInstances> HighlightInstances;
+	/* Key of the mesh used for a highlight type in TileHighlights and HighlightInstances */
+	FName GetHighlightMeshKey(FName Type) const;
+	bool UsesSingleHighlightMesh() const { return bSingleHighlightMesh && GetHighlightMaterial(); }
+	/* HighlightMaterial, or the default material when it is not set. NULL if there is neither */
+	UMaterialInterface *GetHighlightMaterial() const;
+	/* Write the style of Type to the custom data of an instance of the shared highlight mesh */
+	void SetHighlightCustomData(UInstancedStaticMeshComponent &Comp, int32 Instance, FName Type) const;
+	/* Start collecting changes to a highlight set, Pending is initialized to the tiles that currently have it */
+	void BeginHighlightChanges(FTileHighlightSet &Set);
+	/* Update the instanced mesh for Type, only touching the instances of tiles that gain or lose the highlight */
+	void ApplyTileHighlights(FName Type, FTileHighlightSet &Set);
+	/* Drop every highlight of Tile right away, it is about to be unregistered or recycled */
+	void RemoveTileHighlights(const UNavTileComponent &Tile);
+	/* Move the highlights of Tile after it has moved */
+	void UpdateTileHighlights(const UNavTileComponent &Tile);
 public:
+	/* Highlight exactly these tiles with Type, replacing the tiles that had it before. Only tiles that gain or lose the highlight are updated */
+	UFUNCTION(BlueprintCallable, Category = "NavGrid")
+	void SetHighlightedTiles(FName Type, const TArray<UNavTileComponent *> &HighlightedTiles);
+	/* Add Tile to the tiles highlighted with Type. The change is applied at the end of the frame */
 	void SetTileHighlight(UNavTileComponent &Tile, FName Type);
+	/* Remove every highlight. The change is applied at the end of the frame, so tiles that are highlighted again within the same frame are left untouched */
 	void ClearTileHighlights();
-	void AddHighlightType(const FName &Type, const TCHAR *FileName);
+	/* Apply the changes from SetTileHighlight() and ClearTileHighlights() now instead of at the end of the frame */
+	void FlushTileHighlights();
+	/* Register a highlight type. FileName is its material, Style is used instead when bSingleHighlightMesh is set */
+	void AddHighlightType(const FName &Type, const TCHAR *FileName, const FNavGridHighlightStyle &Style = FNavGridHighlightStyle());
 	UInstancedStaticMeshComponent *GetHighlightComponent(FName Type);
+
+	/* Draw every highlight type with one hierarchical instanced mesh using HighlightMaterial, instead of one mesh and material per type. Must be set before any tile is highlighted */
+	UPROPERTY(EditAnyWhere, BlueprintReadOnly, Category = "Highlight")
+	bool bSingleHighlightMesh = false;
+	/* Material for bSingleHighlightMesh. It should read its colour from per instance custom data 0-3 and its pattern from custom data 4. Editor builds fall back to an unlit material showing the colour when this is not set */
+	UPROPERTY(EditAnyWhere, BlueprintReadOnly, Category = "Highlight")
+	UMaterialInterface *HighlightMaterial = nullptr;
+	/* Colour and pattern of each highlight type when bSingleHighlightMesh is set */
+	UPROPERTY(EditAnyWhere, BlueprintReadOnly, Category = "Highlight")
+	TMap<FName, FNavGridHighlightStyle> HighlightStyles;
 public:
 
 	/* Number of tiles that exist in the current level */
 	UPROPERTY(VisibleAnywhere, Category = "NavGrid")
 	int32 NumPersistentTiles = 0;
+	/* Virtual tiles are recycled when there are more than this, starting with the ones farthest from any pawn */
 	UPROPERTY(EditAnyWhere)
 	int32 MaxVirtualTiles = 10000;
+	/* Time spent placing virtual tiles each frame, in microseconds. Set to zero to place every tile in range at once */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "NavGrid", meta = (ClampMin = 0))
+	float VirtualTileBudgetMicroseconds = 2000;
+	/* Triggered when every virtual tile within the movement range of a pawn has been placed */
+	UPROPERTY(BlueprintAssignable, Category = "NavGrid")
+	FOnVirtualTilesGenerated OnVirtualTilesGenerated;
 
 	UFUNCTION(BlueprintCallable, Category = "NavGrid")
 	static ANavGrid *GetNavGrid(AActor *ActorInWorld);
@@ -80,9 +242,16 @@ public:
 
 	/* Get tile from world location, may return NULL */
 	virtual UNavTileComponent *GetTile(const FVector &WorldLocation, bool FindFloor = true, float UpwardTraceLength = 100, float DownwardTraceLength = 100);
+	/* Should GetTile() fall back to line traces when no tile is found in the spatial index. Only needed for tiles that are not registered with this grid */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "NavGrid")
+	bool bTraceForUnindexedTiles = true;
 protected:
 	UNavTileComponent *LineTraceTile(const FVector &WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength);
 	UNavTileComponent *LineTraceTile(const FVector &Start, const FVector &End);
+	/* Find a tile in the spatial index. Mimics the line traces done by LineTraceTile() without touching the physics scene */
+	UNavTileComponent *FindIndexedTile(const FVector &WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength);
+	/* Like FindIndexedTile(), but returns the index of the tile. Returns INDEX_NONE if there is no tile */
+	int32 FindTileIndex(const FVector &WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength);
 
 public:
 	void TileClicked(const UNavTileComponent *Tile);
@@ -93,22 +262,143 @@ protected:
 	/* Do pathfinding and and store all tiles that Pawn can reach in TilesInRange */
 	virtual void CalculateTilesInRange(AGridPawn *Pawn);
 public:
-	/* Find all tiles in range. Call CalculateTilesInRange if neccecary */
+	/* Do pathfinding and store the indices of all tiles that Pawn can reach in OutTileIndices. Distances and backpointers are stored in Context */
+	void CalculateTilesInRange(AGridPawn *Pawn, FNavGridSearchContext &Context, TArray<int32> &OutTileIndices);
+	/* Find all tiles in range. Results are cached, so CalculateTilesInRange is only called if neccecary */
 	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
 	void GetTilesInRange(AGridPawn *Pawn, TArray<UNavTileComponent *> &OutTiles);
-	/* Reset all temporary data in all tiles in the world */
+	/*
+	* Like GetTilesInRange(), but places every virtual tile around Pawn first, ignoring VirtualTileBudgetMicroseconds.
+	* The result is never provisional. Use this where the answer decides what the pawn does, or where the grid does not tick
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void GetCompleteTilesInRange(AGridPawn *Pawn, TArray<UNavTileComponent *> &OutTiles);
+	/*
+	* Find the cheapest path from Start to Target using A*.
+	*
+	* MaxCost - Ignore paths that cost more than this. Use a negative value for no limit
+	* Context - Holds the search state. Distances and backpointers can be read from it afterwards
+	* OutPath - Indices of the tiles along the path, from Start to Target (see GetTileByIndex())
+	*
+	* Returns false if there is no path
+	*/
+	bool FindPath(AGridPawn *Pawn, const UNavTileComponent *Start, const UNavTileComponent &Target, float MaxCost, FNavGridSearchContext &Context, TArray<int32> &OutPath);
+	/* Find the cheapest path from the tile Pawn is on to Target */
+	bool FindPath(AGridPawn *Pawn, const UNavTileComponent &Target, float MaxCost, TArray<int32> &OutPath);
+	/*
+	* Plan a route to Target that may take several turns. The route is split into legs that each cost at most
+	* the pawns MovementRange and end on a tile where the pawn can end its turn.
+	*
+	* Routes are cached per pawn. As long as the pawn stays on its route and the rest of the route is
+	* unobstructed, later calls reuse the cached route instead of searching again.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	bool PlanRoute(AGridPawn *Pawn, UNavTileComponent *Target, FNavGridRoute &OutRoute);
+	/* Throw away the cached route for Pawn */
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void ForgetRoute(AGridPawn *Pawn) { PlannedRoutes.Remove(Pawn); }
+	/* Admissible estimate of the cost of moving between two tiles, used as the heuristic in FindPath(). Uses the bounds taken by UpdateHeuristicBounds() */
+	float EstimateCost(const UNavTileComponent &From, const UNavTileComponent &To) const;
+	float EstimateCost(int32 FromIndex, int32 ToIndex) const;
+	/* Recompute MinTileCost and MaxEdgeLength if tiles or edges have changed, and take them for the next search. Call this before every search that uses EstimateCost() */
+	void UpdateHeuristicBounds();
+	/* Distance to Tile found by the latest call to GetTilesInRange(), infinite if it was not reached */
+	float GetDistance(const UNavTileComponent &Tile) const;
+	/* Previous tile on the path to Tile found by the latest call to GetTilesInRange() */
+	UNavTileComponent *GetBackpointer(const UNavTileComponent &Tile);
+	/* Was Tile expanded by the latest call to GetTilesInRange() */
+	bool IsVisited(const UNavTileComponent &Tile) const;
+	/* Clear the result of the latest range search */
 	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
 	void ClearTiles();
+	/*
+	* True if the latest range search ran while virtual tiles were still being placed around the pawn. The result
+	* is recalculated by GetTilesInRange() once OnVirtualTilesGenerated has been triggered
+	*/
+	UFUNCTION(BlueprintPure, Category = "Pathfinding")
+	bool AreTilesInRangeProvisional() const { return bTilesInRangeProvisional; }
 protected:
-	/* Contains tiles found in the last call to CalculateTilesInRange() */
-	UPROPERTY()
-	TArray<UNavTileComponent *> TilesInRange;
+	/* Indices of the tiles found in the last call to CalculateTilesInRange(). GetTilesInRange() gets their components */
+	TArray<int32> TilesInRange;
 	/* Latest Pawn passed to CalculcateTilesInRange() */
 	UPROPERTY()
 	AGridPawn *CurrentPawn;
 	/* Starting Tile for the latest call to CalculcateTilesInRange() */
 	UPROPERTY()
 	UNavTileComponent *CurrentTile;
+	/* Cache key and occupancy for the result currently in TilesInRange and RangeContext */
+	FNavGridRangeCacheKey CurrentRangeKey;
+	uint32 CurrentOccupancyHash = 0;
+	/* Bounds of the tiles in TilesInRange and CurrentTile */
+	FBox CurrentRangeBounds = FBox(ForceInit);
+	bool bTilesInRangeProvisional = false;
+	/* Distances and backpointers found in the last call to CalculateTilesInRange() */
+	FNavGridSearchContext RangeContext;
+	/* Search state for FindPath() when the caller does not supply its own */
+	FNavGridSearchContext PathContext;
+	/* Routes found by PlanRoute(), one per pawn. Pawns forget their route in EndPlay, see UGridMovementComponent::EndPlay() */
+	UPROPERTY()
+	TMap<TWeakObjectPtr<AGridPawn>, FNavGridRoute> PlannedRoutes;
+	/* Try to reuse the cached route for Pawn. Trims the part of the route that is already behind the pawn */
+	bool ReuseRoute(AGridPawn *Pawn, UNavTileComponent *Target, FNavGridRoute &InOutRoute);
+	/* Can a pawn with Capsule still step from one tile to the next, using the same edges as FindPath() */
+	bool IsRouteStepOpen(int32 FromIndex, int32 ToIndex, const UCapsuleComponent &Capsule, int32 Profile);
+	/* Split Route.Tiles into legs. Returns false if the route can not be split into legs the pawn can complete */
+	bool SplitRoute(AGridPawn *Pawn, FNavGridRoute &InOutRoute) const;
+	/* Update the distance and backpointer for ToIndex if TentativeDistance is an improvement. Returns true if anything changed */
+	bool RelaxEdge(FNavGridSearchContext &Context, int32 FromIndex, int32 ToIndex, float TentativeDistance) const;
+	/* Lowest Cost of any registered tile. Lowered right away when a tile gets cheaper, see UpdateHeuristicBounds() */
+	float MinTileCost = 1;
+	/* Longest horizontal distance (along X or Y) between two neighbouring tiles found while baking. Raised right away when a longer edge is baked */
+	float MaxEdgeLength = 0;
+	/* Set when MinTileCost or MaxEdgeLength may be looser than they need to be, e.g. because a tile got more expensive or was removed */
+	bool bHeuristicBoundsDirty = true;
+	/* MinTileCost and MaxEdgeLength as taken by UpdateHeuristicBounds() at the start of the current search */
+	float HeuristicTileCost = 0;
+	float HeuristicStepLength = 1;
+public:
+	/* Number of tiles expanded by the latest call to CalculateTilesInRange() */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	int32 NumExpandedTiles = 0;
+
+// Range cache
+public:
+	/* Memory budget for cached range results, in kilobytes. Set to zero to disable the cache */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Pathfinding", meta = (ClampMin = 0))
+	int32 RangeCacheBudgetKB = 1024;
+	/* Number of range searches answered from the cache */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	int32 NumRangeCacheHits = 0;
+	/* Number of range searches that had to be calculated */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Pathfinding")
+	int32 NumRangeCacheMisses = 0;
+	/* Throw away every cached range result and snapshot. Needed if tiles are changed in ways the grid can not detect, e.g. without calling UpdateTileRecord() */
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void InvalidateRangeCache();
+	/* Throw away the snapshot and the cached range results that may have reached a tile within Bounds */
+	void InvalidateRangeCacheNear(const FBox &Bounds);
+	FNavGridRangeCacheKey GetRangeCacheKey(AGridPawn *Pawn);
+	/* Hash of the tiles blocked by every grid pawn except IgnoredPawn, see PawnTiles. Changes whenever one of them moves to another tile */
+	uint32 GetOccupancyHash(const AGridPawn *IgnoredPawn);
+	/* Called by UGridMovementComponent when the tile its pawn occupies changes, keeps PawnTiles and GetOccupancyHash() up to date */
+	void SetPawnTile(const AGridPawn &Pawn, UNavTileComponent *Tile);
+	/* Does Pawn keep other pawns out of its tile? True if any of its components blocks ECC_Pawn queries, like the Obstructed() sweeps would */
+	static bool BlocksOtherPawns(const AGridPawn &Pawn);
+	/* Called by UGridMovementComponent when its pawn leaves the game */
+	void RemovePawn(const AGridPawn &Pawn);
+protected:
+	FNavGridRangeCache RangeCache;
+	/*
+	* Tile index blocked by each pawn that has told us about its tile, see SetPawnTile(). INDEX_NONE for pawns that
+	* are off the grid or do not block other pawns. Searches read this instead of asking every pawn for its tile
+	*/
+	TMap<TWeakObjectPtr<const AGridPawn>, int32> PawnTiles;
+	/* Sum of the hashes of the tiles in PawnTiles */
+	uint32 TotalOccupancyHash = 0;
+	/* Set when tiles are registered, as pawns that were not on a tile may now be standing on one */
+	bool bPawnTilesStale = false;
+	/* Look up the tile again for every pawn in PawnTiles that does not block one, if bPawnTilesStale is set */
+	void UpdateUnplacedPawnTiles();
 
 public:
 	/* Triggered by mouse clicks on tiles*/
@@ -131,17 +421,246 @@ public:
 	FVector AdjustToTileLocation(const FVector &Location);
 
 protected:
-	UPROPERTY(VisibleAnywhere, Category = "NavGrid")
-	TArray<UNavTileComponent *> VirtualTiles;
-	/* place virtual tiles within the movement range of a pawn */
+	/* Like ConsiderPlaceTile(), but adds a virtual tile that only exists as a record. Returns its index, or INDEX_NONE if no tile was added */
+	int32 ConsiderPlaceVirtualTile(const FVector &TraceStart, const FVector &TraceEnd);
+	/* Return the index of a tile whose bounds overlap the box around Location, or INDEX_NONE */
+	int32 FindOverlappingTile(const FVector &Location, const FVector &Extent);
+	/* Indices of the virtual tiles. They have no component unless one was asked for, see GetTileByIndex() */
+	TArray<int32> VirtualTiles;
+	/*
+	* place virtual tiles within the movement range of a pawn. The tile under the pawn is placed at once, the rest
+	* are placed in rings outward from the pawn over the next frames, see VirtualTileBudgetMicroseconds
+	*/
 	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
 	void GenerateVirtualTiles(const AGridPawn *Pawn);
 	/* place a single virtual tile under a pawn */
 	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
 	void GenerateVirtualTile(const AGridPawn *Pawn);
 	void DestroyVirtualTiles();
+	/* Components of evicted virtual tiles. They are unregistered and reused by PlaceTile() and GetTileByIndex() instead of creating new components */
+	UPROPERTY(Transient)
+	TArray<UNavTileComponent *> VirtualTilePool;
+	/*
+	* Recycle virtual tiles until NumNeeded more fit within MaxVirtualTiles. Tiles farthest from any pawn go first, then the least recently used.
+	* Tiles that pawns stand on or follow a path through are never recycled
+	*/
+	void EvictVirtualTiles(int32 NumNeeded);
+	/* Remove the virtual tile with this index. Its component, if it has one, is put in VirtualTilePool */
+	void RecycleVirtualTile(int32 TileIndex);
+	/* Take a tile of TileClass from VirtualTilePool, returns nullptr if there are none */
+	UNavTileComponent *TakePooledTile();
+public:
+	/* Are virtual tiles still being placed around Pawn */
+	UFUNCTION(BlueprintPure, Category = "Pathfinding")
+	bool IsGeneratingVirtualTiles(const AGridPawn *Pawn) const;
+	/* Place the rest of the virtual tiles around the pawn they are being placed for right away, ignoring VirtualTileBudgetMicroseconds */
+	void CompleteVirtualTileJob();
+protected:
+	/* Virtual tile placement that has not finished yet. Cells are visited ring by ring, and top to bottom within each cell */
+	struct FVirtualTileJob
+	{
+		TWeakObjectPtr<const AGridPawn> Pawn;
+		FVector Center = FVector::ZeroVector;
+		/* Number of rings around the center cell */
+		int32 Radius = 0;
+		int32 Ring = 0;
+		/* Cell within the current ring. Ring N has 8 * N cells */
+		int32 RingCell = 0;
+		/* Vertical step within the current cell, there are 2 * Radius + 1 steps */
+		int32 ZStep = 0;
+		bool bActive = false;
+
+		/* Offset from the center, in tiles, of the current cell */
+		FIntPoint GetCellOffset() const;
+		/* Move on to the next trace. Returns false when every cell has been visited */
+		bool Advance();
+		int32 GetNumPendingTraces() const;
+	};
+	FVirtualTileJob VirtualTileJob;
+	/* Center and radius of the last VirtualTileJob that finished. GenerateVirtualTiles() does nothing for the same area until tiles or obstacles around it change */
+	FVector GeneratedCenter = FVector::ZeroVector;
+	int32 GeneratedRadius = INDEX_NONE;
+	/* Forget the last generated area if it is within Bounds */
+	void InvalidateGeneratedArea(const FBox &Bounds);
+	/* Place virtual tiles for VirtualTileJob until it is done or VirtualTileBudgetMicroseconds has been spent */
+	void RunVirtualTileJob();
+	/* Called when VirtualTileJob is done. Drops a provisional range result and triggers OnVirtualTilesGenerated */
+	void FinishVirtualTileJob();
+	void CancelVirtualTileJob();
 	virtual void Destroyed() override;
+// Baked virtual tiles
+public:
+	/* Virtual tiles found by BakeVirtualTiles(). They are placed at BeginPlay without any traces, and virtual tiles are only traced for outside the baked area */
+	UPROPERTY(EditAnyWhere, BlueprintReadOnly, Category = "NavGrid")
+	UNavGridBakedTiles *BakedVirtualTiles = nullptr;
+#if WITH_EDITOR
+	/* Search the whole level for virtual tiles and store them in BakedVirtualTiles, which must be set to a NavGridBakedTiles data asset */
+	UFUNCTION(CallInEditor, Category = "NavGrid")
+	void BakeVirtualTiles();
+#endif
+protected:
+	/* Indices of the tiles loaded from BakedVirtualTiles. They are never evicted */
+	TArray<int32> BakedTiles;
+	bool bPlacedBakedTiles = false;
+	/* Add the tiles in BakedVirtualTiles as records and give them their baked edges. Components are created on demand, see GetTileByIndex() */
+	void PlaceBakedTiles();
+	/* Is Location covered by the tiles placed from BakedVirtualTiles */
+	bool IsInBakedArea(const FVector &Location) const;
+// Baked neighbour graph
+public:
+	/* Capsule shapes that tile edges are baked for. Each shape gets one bit in FNavTileEdge::ObstructedProfiles */
+	UPROPERTY(VisibleAnywhere, Category = "Pathfinding")
+	TArray<FNavGridCapsuleProfile> CapsuleProfiles;
+	/* Return the profile index for Capsule, adding a new profile if needed. Returns INDEX_NONE if every profile slot is taken */
+	int32 GetCapsuleProfile(const UCapsuleComponent &Capsule);
+	/* Return the index of a matching profile, adding InProfile if needed. Returns INDEX_NONE if every profile slot is taken */
+	int32 FindOrAddCapsuleProfile(const FNavGridCapsuleProfile &InProfile);
+	/* Get the baked edges for a tile, bakes them for Profile if they are missing or stale */
+	const TArray<FNavTileEdge> &GetTileEdges(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile);
+	/* Return the indices of the neighbours of a tile that are not obstructed for Profile. Does not perform any physics queries if the edges are already baked */
+	void GetBakedNeighbours(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile, TArray<int32> &OutNeighbours);
+	/* Bake edges for every tile using the movement capsules of every grid pawn in the level */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category = "Pathfinding")
+	void BakeNeighbourGraph();
+	/* Throw away all baked edges and capsule profiles */
+	UFUNCTION(BlueprintCallable, CallInEditor, Category = "Pathfinding")
+	void ClearNeighbourGraph();
+	/* Response params for the Obstructed() sweeps made while baking edges. Pawns are ignored, the tiles they stand on are blocked by BlockOccupiedTiles() instead */
+	static const FCollisionResponseParams &GetBakeResponseParams();
+protected:
+	void BakeTileEdges(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile);
+	/*
+	* Find the neighbours of a tile with physics queries. Tiles with a component ask it with UNavTileComponent::GetNeighbours(),
+	* tiles that only exist as a record are looked up in the spatial index
+	*/
+	void FindNeighbours(int32 TileIndex, const UCapsuleComponent &Capsule, const FCollisionResponseParams &ResponseParams, TArray<int32> &OutUnObstructed, TArray<int32> &OutObstructed);
+	/* Is moving from one tile to another obstructed for Capsule. Uses UNavTileComponent::Obstructed() of whichever tile has a component */
+	bool IsEdgeObstructed(int32 FromIndex, int32 ToIndex, const UCapsuleComponent &Capsule, const FCollisionResponseParams &ResponseParams) const;
+	/* Mark the tiles in PawnTiles as blocked, except the one occupied by IgnoredPawn */
+	void BlockOccupiedTiles(const AGridPawn *IgnoredPawn, FNavGridSearchContext &Context);
+
+// Asynchronous queries
+public:
+	/*
+	* Find a path from the tile Pawn is on to Target on a worker thread. OnDone is called on the game thread when the
+	* query completes, unless it is cancelled first. Returns an invalid handle if the query could not be started
+	*/
+	FNavGridQueryHandle FindPathAsync(AGridPawn *Pawn, const UNavTileComponent &Target, float MaxCost, FOnNavGridQueryDone OnDone);
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding", meta = (DisplayName = "Find Path Async"))
+	FNavGridQueryHandle K2_FindPathAsync(AGridPawn *Pawn, UNavTileComponent *Target, float MaxCost, FOnNavGridQueryDoneDynamic OnDone);
+	/* Find every tile Pawn can reach this turn on a worker thread. Virtual tiles are not generated */
+	FNavGridQueryHandle GetTilesInRangeAsync(AGridPawn *Pawn, FOnNavGridQueryDone OnDone);
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding", meta = (DisplayName = "Get Tiles In Range Async"))
+	FNavGridQueryHandle K2_GetTilesInRangeAsync(AGridPawn *Pawn, FOnNavGridQueryDoneDynamic OnDone);
+	/* Stop a query, its delegate will not be called */
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void CancelQuery(FNavGridQueryHandle Handle);
+	UFUNCTION(BlueprintPure, Category = "Pathfinding")
+	bool IsQueryPending(FNavGridQueryHandle Handle) const { return PendingQueries.Contains(Handle.Id); }
+	/* Get a read-only copy of this grid that can be searched from other threads. Edges are baked for Profile first if needed */
+	TSharedPtr<const FNavGridSnapshot, ESPMode::ThreadSafe> GetSnapshot(const UCapsuleComponent &Capsule, int32 Profile);
+protected:
+	struct FPendingQuery
+	{
+		FOnNavGridQueryDone OnDone;
+		TSharedPtr<FThreadSafeBool, ESPMode::ThreadSafe> bCancelled;
+	};
+	FNavGridQueryHandle StartQuery(AGridPawn *Pawn, const UNavTileComponent *Target, float MaxCost, FOnNavGridQueryDone OnDone);
+	void FinishQuery(int32 Id, const FNavGridSnapshot &QuerySnapshot, bool bSuccess, const TArray<int32> &TileIndices, const TArray<float> &Distances);
+	/* Latest snapshot, thrown away whenever the grid changes */
+	TSharedPtr<const FNavGridSnapshot, ESPMode::ThreadSafe> Snapshot;
+	/* Profiles Snapshot can be used for. Usually its baked profiles, plus the profile it was made for if baking did not settle */
+	uint32 SnapshotProfiles = 0;
+	TMap<int32, FPendingQuery> PendingQueries;
+	int32 NextQueryId = 1;
+
+// Hierarchical pathfinding
+public:
+	/* Let PlanRoute() search the hierarchical graph when the start and target are in different clusters */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Pathfinding")
+	bool bUseHierarchicalPathfinding = true;
+	/* Width and depth of a cluster in the hierarchical graph, in tiles */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Pathfinding", meta = (ClampMin = 2))
+	int32 ClusterSize = 16;
+	/* Height of a cluster in the hierarchical graph. Should be about the distance between two floors */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, Category = "Pathfinding")
+	float ClusterHeight = 400;
+	/*
+	* Find a path from the tile Pawn is on to Target using the hierarchical graph. The path is not limited by cost.
+	* Falls back to FindPath() when both tiles are in the same cluster, or if the path is blocked by another pawn
+	*/
+	bool FindPathHierarchical(AGridPawn *Pawn, const UNavTileComponent &Target, FNavGridSearchContext &Context, TArray<int32> &OutPath);
+	/* Get the hierarchical graph for a capsule profile and set of movement modes, creating it if needed */
+	FNavGridHierarchy &GetHierarchy(int32 Profile, const FGridMovementModes &MovementModes);
+protected:
+	/* One hierarchical graph per capsule profile and set of movement modes in use */
+	TArray<TUniquePtr<FNavGridHierarchy>> Hierarchies;
+
+// Tile registry
+public:
+	/* Add a tile to this grid and give it a TileIndex. Called when a tile is registered or moved to this grid */
+	void RegisterTile(UNavTileComponent *Tile);
+	/* Remove a tile from this grid, its TileIndex will be reused by the next tile that is registered */
+	void UnregisterTile(UNavTileComponent *Tile);
+	/* Add a tile of TileClass that only exists as a record, returns its index. See GetTileByIndex() */
+	int32 AddTileRecord(const FVector &Location, const FVector &Extent);
+	/* Update the tile record, spatial index and hierarchical graph after Tile has moved */
+	void UpdateTileLocation(UNavTileComponent *Tile);
+	/* Copy Tile into its record, e.g. after its Cost or MovementModes have changed */
+	void UpdateTileRecord(UNavTileComponent &Tile);
+	/* Record of the tile with this index, only valid for registered tiles. Searches and picking read these instead of the components */
+	const FNavGridTileRecord &GetTileRecord(int32 Index) const { return TileRecords[Index]; }
+	/* Is a tile registered with this index */
+	bool IsValidTileIndex(int32 Index) const { return TileRecords.IsValidIndex(Index) && TileRecords[Index].bRegistered; }
+	/* Get the index of Tile, registering it with this grid if it does not belong to a grid yet. Returns INDEX_NONE for tiles on other grids */
+	int32 GetTileIndex(UNavTileComponent &Tile);
+	/* Get the component of the tile with this index, creating one if the tile only exists as a record */
+	UNavTileComponent *GetTileByIndex(int32 Index);
+	/* Get the component of the tile with this index, returns nullptr if the tile only exists as a record */
+	UNavTileComponent *FindTileComponent(int32 Index) const { return Tiles.IsValidIndex(Index) ? Tiles[Index] : nullptr; }
+	/* Upper bound for TileIndex, use this when sizing per-tile buffers */
+	int32 GetNumTileIndices() const { return Tiles.Num(); }
+	/* Number of tiles currently registered with this grid */
+	int32 GetNumTiles() const { return Tiles.Num() - FreeTileIndices.Num(); }
+	/* Get every tile registered with this grid. Creates a component for every tile that only exists as a record, prefer GetTileRecord() */
+	UFUNCTION(BlueprintCallable, Category = "NavGrid")
+	void GetAllTiles(TArray<UNavTileComponent *> &OutTiles);
+protected:
+	/* Component of every tile registered with this grid, indexed by UNavTileComponent::TileIndex. NULL for unused slots and for tiles that only exist as a record */
+	UPROPERTY(Transient)
+	TArray<UNavTileComponent *> Tiles;
+	/* Unused slots in Tiles */
+	TArray<int32> FreeTileIndices;
+	/* Indexed by TileIndex, like Tiles */
+	TArray<FNavGridTileRecord> TileRecords;
+	/* Set while GetTileByIndex() registers a component for a tile that only exists as a record, RegisterTile() gives it this index */
+	int32 AdoptedTileIndex = INDEX_NONE;
+	/* Record of the default object of TileClass, used for tiles that only exist as a record */
+	FNavGridTileRecord DefaultTileRecord;
+	UClass *DefaultTileRecordClass = nullptr;
+	/* Free a tile index and update everything that may refer to it */
+	void UnregisterTileIndex(int32 Index);
+	/* Update the spatial index, edges, hierarchical graphs and range cache after a tile has been added or moved */
+	void TilePlacementChanged(int32 Index, const FBox &OldBounds);
+
+// Spatial index
+public:
+	/* Add a tile to the spatial index, or move it if it is already there */
+	void UpdateSpatialIndex(int32 TileIndex);
+	/* Get the indices of the tiles whose bounds intersect Bounds */
+	void GetTilesNear(const FBox &Bounds, TArray<int32> &OutTileIndices);
+protected:
+	void RemoveFromSpatialIndex(int32 TileIndex);
+	void RebuildSpatialIndex();
+	/* Mark the edges of every tile that may have an edge to a tile within Bounds as stale */
+	void InvalidateEdgesNear(const FBox &Bounds);
+	FIntPoint GetSpatialCell(float X, float Y) const;
+	/* Tile indices bucketed by quantized (X, Y) location. Each cell holds every tile overlapping it, on every floor */
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> SpatialIndex;
+	/* TileSize used when the spatial index was built */
+	float SpatialCellSize = 0;
+
 public:
-	/** return every tile in the supplied world */
+	/** return every tile in the supplied world. This iterates over every tile object in memory, prefer GetAllTiles() */
 	static void GetEveryTile(TArray<UNavTileComponent* > &OutTiles, UWorld *World);
 };
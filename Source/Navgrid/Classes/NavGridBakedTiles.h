@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "NavGrid.h"
+#include "NavGridBakedTiles.generated.h"
+
+/**
+* Virtual tiles found ahead of time by ANavGrid::BakeVirtualTiles(), so they can be placed at runtime without any traces.
+*
+* Tiles are stored in parallel arrays and refer to each other by their index in those arrays. The neighbours of
+* tile N are EdgeTargets[EdgeOffsets[N]] to EdgeTargets[EdgeOffsets[N + 1] - 1]. Edges are only stored between
+* baked tiles, so tiles that may touch any other tile are marked in BorderTiles and get their edges baked at
+* runtime as usual.
+*/
+UCLASS(BlueprintType)
+class NAVGRID_API UNavGridBakedTiles : public UDataAsset
+{
+	GENERATED_BODY()
+public:
+	virtual void Serialize(FArchive &Ar) override;
+
+	/* Area that was searched for tiles. ANavGrid does not trace for virtual tiles inside it */
+	UPROPERTY(VisibleAnywhere, Category = "NavGrid")
+	FBox Bounds = FBox(ForceInit);
+	/* ANavGrid::TileSize used when baking */
+	UPROPERTY(VisibleAnywhere, Category = "NavGrid")
+	float TileSize = 0;
+	/* Capsule shapes that EdgeObstructedProfiles refer to */
+	UPROPERTY(VisibleAnywhere, Category = "NavGrid")
+	TArray<FNavGridCapsuleProfile> CapsuleProfiles;
+
+	int32 Num() const { return Locations.Num(); }
+	void Empty();
+
+	TArray<FVector> Locations;
+	TArray<FVector> Extents;
+	/* Set for tiles that may have neighbours that are not in this asset */
+	TBitArray<> BorderTiles;
+	TArray<int32> EdgeOffsets;
+	TArray<int32> EdgeTargets;
+	/* One bit per entry in CapsuleProfiles, set if moving along the edge is obstructed for that profile */
+	TArray<uint32> EdgeObstructedProfiles;
+};
@@ -6,8 +6,12 @@
 #include "GameFramework/GameModeBase.h"
 #include "NavGridGameMode.generated.h"
 
+class AGridPawn;
+class ANavGrid;
+class UTurnComponent;
+
 /**
- * 
+ * Runs matches either normally or as a headless simulation (see StartSimulation())
  */
 UCLASS()
 class NAVGRID_API ANavGridGameMode : public AGameModeBase
@@ -16,4 +20,39 @@ class NAVGRID_API ANavGridGameMode : public AGameModeBase
 public:
 	ANavGridGameMode();
 	virtual void BeginPlay() override;
+
+	/*
+	* Play the match as fast as possible without rendering or waiting for anything: every pawn in the level
+	* is AI controlled and moves instantly, and turns are started as soon as the previous one ends. Stops after
+	* MaxTurns turns or when fewer than two teams remain. Seed is used for FMath::Rand() and FMath::FRand().
+	*
+	* The first simulated turn starts next frame, a turn that is already in progress is ended. Started from BeginPlay()
+	* when the game runs with -NavGridSimulate=<MaxTurns>, together with the optional -NavGridSeed=<Seed> and
+	* -NavGridSimulationLog=<File>. The game exits when that simulation is done.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "NavGrid")
+	void StartSimulation(int32 MaxTurns, int32 Seed);
+	UFUNCTION(BlueprintPure, Category = "NavGrid")
+	bool IsSimulating() const { return bSimulating; }
+	/* Make Pawn AI controlled and move instantly. Done for every pawn when the simulation starts, and by pawns that begin play while simulating */
+	void ApplySimulationSettings(AGridPawn &Pawn) const;
+
+protected:
+	/* Start as many turns as the AI allows this frame */
+	void StepSimulation();
+	void FinishSimulation();
+	UFUNCTION()
+	void OnSimulatedTurnEnd(UTurnComponent *TurnComponent);
+
+	bool bSimulating = false;
+	bool bExitAfterSimulation = false;
+	int32 MaxSimulatedTurns = 0;
+	int32 NumSimulatedTurns = 0;
+	double SimulationStartTime = 0;
+	/* VirtualTileBudgetMicroseconds of each grid before the simulation. Grids place every virtual tile at once while simulating */
+	TMap<TWeakObjectPtr<ANavGrid>, float> SavedVirtualTileBudgets;
+	/* File to write SimulationLog to, nothing is written if empty */
+	FString SimulationLogFile;
+	/* One 'round,team,pawn,tile' line per turn, tile is the TileIndex the pawn ended its turn on */
+	FString SimulationLog;
 };
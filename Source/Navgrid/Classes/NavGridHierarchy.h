@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridMovementComponent.h"
+#include "NavGridSearchContext.h"
+
+class ANavGrid;
+class UCapsuleComponent;
+
+/**
+* Abstract graph for hierarchical pathfinding (HPA*) on large grids.
+*
+* Tiles are grouped into clusters of ANavGrid::ClusterSize by ClusterSize tiles, stacked every
+* ANavGrid::ClusterHeight units so each floor of a building gets clusters of its own. Wherever a tile
+* has an edge into a neighbouring cluster a portal is created: one for every connected run of border
+* tiles, and one for every edge to or from a ladder. The tiles at either end of a portal are the nodes
+* of the abstract graph, and the cheapest paths between the nodes of a cluster are its edges.
+*
+* Long searches run on the abstract graph first and are then refined one cluster at a time. The graph
+* is built for a single capsule profile and set of movement modes, and does not know about pawns.
+* Clusters are rebuilt lazily when their tiles are added, removed, moved or when their edges change.
+*/
+class NAVGRID_API FNavGridHierarchy
+{
+public:
+	FNavGridHierarchy(ANavGrid &InGrid, int32 InProfile, const FGridMovementModes &InMovementModes);
+
+	/* Is this graph built for Profile and MovementModes */
+	bool Matches(int32 InProfile, const FGridMovementModes &InMovementModes) const;
+	/* False if ANavGrid::ClusterSize, ClusterHeight or TileSize have changed since this graph was created */
+	bool HasCurrentClusterSettings() const;
+	/* Cluster containing a world location */
+	FIntVector GetClusterKey(const FVector &Location) const;
+	bool InSameCluster(int32 TileIndexA, int32 TileIndexB) const;
+
+	/* Sync the cluster membership of a tile after it has been added, removed or moved */
+	void UpdateTile(int32 TileIndex);
+	/* Rebuild the cluster containing a tile the next time the graph is used, e.g. because its edges changed */
+	void MarkDirty(int32 TileIndex);
+	/* Rebuild every dirty cluster */
+	void Rebuild(const UCapsuleComponent &Capsule);
+
+	/*
+	* Search the abstract graph and refine the result into a path of tile indices from Start to Target.
+	* Context holds the abstract search, so distances in it are only valid for abstract nodes.
+	* Start and Target in the same cluster are searched within the cluster first, the same tile gives a one-element path
+	*/
+	bool FindPath(int32 StartIndex, int32 TargetIndex, const UCapsuleComponent &Capsule, FNavGridSearchContext &Context, TArray<int32> &OutPath);
+
+	int32 GetNumClusters() const { return Clusters.Num(); }
+	int32 GetNumNodes() const;
+
+private:
+	struct FEdge
+	{
+		FEdge(int32 InTo, float InCost) : To(InTo), Cost(InCost) {}
+		int32 To;
+		float Cost;
+	};
+	struct FPortal
+	{
+		FPortal(int32 InFrom, int32 InTo, float InCost) : From(InFrom), To(InTo), Cost(InCost) {}
+		/* Tile in the cluster we are leaving */
+		int32 From;
+		/* Tile in the cluster we are entering */
+		int32 To;
+		float Cost;
+	};
+	struct FCluster
+	{
+		/* Every tile in this cluster */
+		TArray<int32> Tiles;
+		/* Clusters that can be entered from this cluster */
+		TSet<FIntVector> Outgoing;
+		/* Clusters that this cluster can be entered from */
+		TSet<FIntVector> Incoming;
+		/* Abstract edges leaving each node of this cluster, both within the cluster and through portals */
+		TMap<int32, TArray<FEdge>> NodeEdges;
+	};
+	typedef TPair<FIntVector, FIntVector> FBoundaryKey;
+
+	/* Recreate the portals going from one cluster to its neighbours, or to a single neighbour if OnlyTo is set */
+	void RebuildPortals(const FIntVector &FromKey, const FIntVector *OnlyTo, const UCapsuleComponent &Capsule, TSet<FIntVector> &OutTouched);
+	/* Recreate the abstract edges of every node in a cluster */
+	void RebuildNodeEdges(const FIntVector &Key, const UCapsuleComponent &Capsule);
+	/* Dijkstra (or A* if To is set) that never leaves the cluster. Results are stored in Context */
+	bool SearchCluster(const FIntVector &Key, int32 From, int32 To, const UCapsuleComponent &Capsule, FNavGridSearchContext &Context);
+	const FIntVector &GetTileCluster(int32 TileIndex) const;
+
+	ANavGrid &Grid;
+	int32 Profile;
+	FGridMovementModes MovementModes;
+	/* Cluster dimensions in world units */
+	float ClusterExtent;
+	float ClusterHeight;
+
+	TMap<FIntVector, FCluster> Clusters;
+	/* Portals between clusters, keyed by (From, To) cluster */
+	TMap<FBoundaryKey, TArray<FPortal>> Portals;
+	/* Cluster of every tile, indexed by TileIndex */
+	TArray<FIntVector> TileClusters;
+	TSet<FIntVector> DirtyClusters;
+	/* Scratch space for searches within a single cluster */
+	FNavGridSearchContext ClusterContext;
+};
@@ -4,6 +4,7 @@
 
 #include "GameFramework/PlayerController.h"
 #include "GenericTeamAgentInterface.h"
+#include "NavGrid.h"
 #include "NavGridPC.generated.h"
 
 class ANavGrid;
@@ -23,6 +24,8 @@ class NAVGRID_API ANavGridPC : public APlayerController
 public:
 	ANavGridPC(const FObjectInitializer& ObjectInitializer);
 	virtual void BeginPlay() override;
+	/* Gives the tile under the cursor a component if it only exists as a record, so it gets cursor and click events */
+	virtual void PlayerTick(float DeltaTime) override;
 
 	UFUNCTION()
 	virtual void OnTileClicked(const UNavTileComponent *Tile);
@@ -30,6 +33,9 @@ public:
 	virtual void OnTileCursorOver(const UNavTileComponent *Tile);
 	UFUNCTION()
 	virtual void OnEndTileCursorOver(const UNavTileComponent *Tile);
+	/* Called when the grid has placed every virtual tile around a pawn. Updates the path to the hovered tile */
+	UFUNCTION()
+	virtual void OnVirtualTilesGenerated(const AGridPawn *Pawn);
 
 	/* Called when a new round starts*/
 	UFUNCTION()
@@ -44,6 +50,18 @@ public:
 	UFUNCTION()
 	virtual void OnTeamTurnStart(const FGenericTeamId &TeamId) {}
 
+	/* Find the path shown when hovering over a tile on a worker thread. Not used if the grid has virtual tiles enabled */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bAsyncCursorPaths = true;
+protected:
+	/* Called when the path to the hovered tile has been found */
+	virtual void OnCursorPathFound(const FNavGridQueryResult &Result);
+	/* Path query for the hovered tile */
+	FNavGridQueryHandle CursorQuery;
+	/* Tile under the cursor, if any */
+	TWeakObjectPtr<const UNavTileComponent> HoveredTile;
+public:
+
 	virtual void SetTurnManager(ATurnManager * InTurnManager);
 	virtual void SetGrid(ANavGrid * InGrid);
 
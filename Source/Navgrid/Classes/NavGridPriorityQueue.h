@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Indexed binary min-heap over integer node ids.
+*
+* Every node can be in the queue at most once, pushing a node that is already queued
+* will update its priority in place (decrease-key) instead of adding a duplicate.
+*/
+class FNavGridPriorityQueue
+{
+public:
+	/* Insert Node, or change its priority if it is already queued */
+	void Push(int32 Node, float Priority)
+	{
+		if (Node >= Positions.Num())
+		{
+			int32 OldNum = Positions.Num();
+			Positions.SetNumUninitialized(Node + 1);
+			for (int32 Idx = OldNum; Idx < Positions.Num(); Idx++)
+			{
+				Positions[Idx] = INDEX_NONE;
+			}
+		}
+
+		int32 HeapIdx = Positions[Node];
+		if (HeapIdx == INDEX_NONE)
+		{
+			HeapIdx = Heap.Add(FEntry(Node, Priority));
+			Positions[Node] = HeapIdx;
+			SiftUp(HeapIdx);
+		}
+		else if (Priority < Heap[HeapIdx].Priority)
+		{
+			Heap[HeapIdx].Priority = Priority;
+			SiftUp(HeapIdx);
+		}
+		else
+		{
+			Heap[HeapIdx].Priority = Priority;
+			SiftDown(HeapIdx);
+		}
+	}
+
+	/* Remove and return the node with the lowest priority */
+	int32 Pop()
+	{
+		check(Heap.Num());
+		int32 Node = Heap[0].Node;
+		Positions[Node] = INDEX_NONE;
+		FEntry Last = Heap.Pop(false);
+		if (Heap.Num())
+		{
+			Heap[0] = Last;
+			Positions[Last.Node] = 0;
+			SiftDown(0);
+		}
+		return Node;
+	}
+
+	/* The node with the lowest priority, without removing it */
+	int32 Peek() const
+	{
+		check(Heap.Num());
+		return Heap[0].Node;
+	}
+
+	/* Remove Node if it is queued */
+	void Remove(int32 Node)
+	{
+		if (!Contains(Node))
+		{
+			return;
+		}
+		int32 HeapIdx = Positions[Node];
+		Positions[Node] = INDEX_NONE;
+		FEntry Last = Heap.Pop(false);
+		if (HeapIdx < Heap.Num())
+		{
+			Heap[HeapIdx] = Last;
+			Positions[Last.Node] = HeapIdx;
+			SiftUp(HeapIdx);
+			SiftDown(Positions[Last.Node]);
+		}
+	}
+
+	bool IsEmpty() const { return Heap.Num() == 0; }
+	int32 Num() const { return Heap.Num(); }
+	bool Contains(int32 Node) const { return Positions.IsValidIndex(Node) && Positions[Node] != INDEX_NONE; }
+
+	/* Remove every queued node. Cost is proportional to the number of queued nodes, not the number of known nodes */
+	void Empty()
+	{
+		for (const FEntry &Entry : Heap)
+		{
+			Positions[Entry.Node] = INDEX_NONE;
+		}
+		Heap.Reset();
+	}
+
+private:
+	struct FEntry
+	{
+		FEntry(int32 InNode, float InPriority) : Node(InNode), Priority(InPriority) {}
+		int32 Node;
+		float Priority;
+	};
+
+	void SiftUp(int32 HeapIdx)
+	{
+		while (HeapIdx > 0)
+		{
+			int32 Parent = (HeapIdx - 1) / 2;
+			if (Heap[Parent].Priority <= Heap[HeapIdx].Priority)
+			{
+				break;
+			}
+			Swap(HeapIdx, Parent);
+			HeapIdx = Parent;
+		}
+	}
+
+	void SiftDown(int32 HeapIdx)
+	{
+		for (;;)
+		{
+			int32 Smallest = HeapIdx;
+			int32 Left = 2 * HeapIdx + 1;
+			int32 Right = Left + 1;
+			if (Left < Heap.Num() && Heap[Left].Priority < Heap[Smallest].Priority)
+			{
+				Smallest = Left;
+			}
+			if (Right < Heap.Num() && Heap[Right].Priority < Heap[Smallest].Priority)
+			{
+				Smallest = Right;
+			}
+			if (Smallest == HeapIdx)
+			{
+				break;
+			}
+			Swap(HeapIdx, Smallest);
+			HeapIdx = Smallest;
+		}
+	}
+
+	void Swap(int32 A, int32 B)
+	{
+		Heap.Swap(A, B);
+		Positions[Heap[A].Node] = A;
+		Positions[Heap[B].Node] = B;
+	}
+
+	/* The binary heap itself */
+	TArray<FEntry> Heap;
+	/* Position of each node in Heap, INDEX_NONE if the node is not queued */
+	TArray<int32> Positions;
+};
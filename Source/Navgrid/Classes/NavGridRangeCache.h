@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridMovementComponent.h"
+#include "NavGridSearchContext.h"
+
+/**
+* Everything that affects the result of a range search, apart from the grid itself and the location of other pawns
+*/
+struct NAVGRID_API FNavGridRangeCacheKey
+{
+	/* UObject::GetUniqueID() of the pawn */
+	uint32 PawnId = 0;
+	int32 StartIndex = INDEX_NONE;
+	float MovementRange = 0;
+	/* FGridMovementModes::Mask of the pawn */
+	uint32 MovementModeMask = 0;
+	/* Shape of the movement collision capsule. Not its profile index, which is INDEX_NONE for every capsule once the grid runs out of profiles */
+	float CapsuleRadius = 0;
+	float CapsuleHalfHeight = 0;
+	FVector CapsuleOffset = FVector::ZeroVector;
+
+	bool operator==(const FNavGridRangeCacheKey &Other) const
+	{
+		return PawnId == Other.PawnId && StartIndex == Other.StartIndex && MovementRange == Other.MovementRange &&
+			MovementModeMask == Other.MovementModeMask && CapsuleRadius == Other.CapsuleRadius &&
+			CapsuleHalfHeight == Other.CapsuleHalfHeight && CapsuleOffset == Other.CapsuleOffset;
+	}
+	bool operator!=(const FNavGridRangeCacheKey &Other) const { return !(*this == Other); }
+	friend uint32 GetTypeHash(const FNavGridRangeCacheKey &Key)
+	{
+		uint32 Hash = HashCombine(Key.PawnId, ::GetTypeHash(Key.StartIndex));
+		Hash = HashCombine(Hash, ::GetTypeHash(Key.MovementRange));
+		Hash = HashCombine(Hash, Key.MovementModeMask);
+		Hash = HashCombine(Hash, ::GetTypeHash(Key.CapsuleRadius));
+		Hash = HashCombine(Hash, ::GetTypeHash(Key.CapsuleHalfHeight));
+		return HashCombine(Hash, ::GetTypeHash(Key.CapsuleOffset));
+	}
+};
+
+/**
+* Least recently used cache of range search results.
+*
+* Only the tiles that were reached are stored, so an entry is much smaller than a FNavGridSearchContext.
+* Every entry is stamped with the occupancy of the grid (see ANavGrid::GetOccupancyHash()) and is thrown
+* away when it is looked up with a different stamp. Changes to tiles must be handled by calling Invalidate()
+* with the area that changed, or Empty() if the whole grid has changed.
+*/
+class NAVGRID_API FNavGridRangeCache
+{
+public:
+	/* Copy a cached result into OutContext and OutTiles. Returns false on a miss */
+	bool Restore(const FNavGridRangeCacheKey &Key, uint32 OccupancyHash, int32 NumTileIndices, FNavGridSearchContext &OutContext, TArray<int32> &OutTiles);
+	/* Store the result of a range search. ReachedTiles should not contain the starting tile. Bounds should contain every tile that was reached */
+	void Store(const FNavGridRangeCacheKey &Key, uint32 OccupancyHash, const FNavGridSearchContext &Context, const TArray<int32> &ReachedTiles, const FBox &Bounds);
+	/* Throw away the entries whose bounds intersect Bounds */
+	void Invalidate(const FBox &Bounds);
+	void Empty();
+
+	/* Evict entries until the cache uses at most Bytes of memory. A budget of zero disables the cache */
+	void SetBudget(SIZE_T Bytes);
+	SIZE_T GetAllocatedSize() const { return AllocatedSize; }
+	int32 Num() const { return Entries.Num(); }
+
+private:
+	struct FEntry
+	{
+		/* Every tile that was reached, the starting tile first */
+		TArray<int32> Tiles;
+		TArray<float> Distances;
+		TArray<int32> Backpointers;
+		/* Bounds of the tiles that were reached */
+		FBox Bounds = FBox(ForceInit);
+		uint32 OccupancyHash = 0;
+		uint64 LastUsed = 0;
+
+		SIZE_T GetAllocatedSize() const;
+	};
+
+	void Remove(const FNavGridRangeCacheKey &Key);
+	void EvictToBudget();
+
+	TMap<FNavGridRangeCacheKey, FEntry> Entries;
+	uint64 UseCounter = 0;
+	SIZE_T AllocatedSize = 0;
+	SIZE_T Budget = 0;
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavGridPriorityQueue.h"
+
+#include <limits>
+
+/**
+* Per-search state for pathfinding on a NavGrid.
+*
+* Every buffer is indexed by UNavTileComponent::TileIndex. Instead of clearing the buffers between
+* searches every entry is stamped with the generation it was written in, and entries from older
+* generations are treated as unset. Resetting a context is therefore O(1) regardless of the number
+* of tiles, and any number of contexts can be used at the same time.
+*
+* UNavTileComponent::Distance, Backpointer and Visited used to hold this state. The deprecated
+* UNavTileComponent::GetDistance(), GetBackpointer() and IsVisited() forward to the range search context of the grid.
+*/
+class NAVGRID_API FNavGridSearchContext
+{
+public:
+	/* Prepare for a new search */
+	void Reset(int32 NumTiles);
+
+	/* Distance from the starting point, infinite if the tile has not been reached */
+	float GetDistance(int32 TileIndex) const
+	{
+		return IsCurrent(DistanceGeneration, TileIndex) ? Distance[TileIndex] : std::numeric_limits<float>::infinity();
+	}
+	/* Previous tile on the path, INDEX_NONE if the tile has not been reached or is the starting point */
+	int32 GetBackpointer(int32 TileIndex) const
+	{
+		return IsCurrent(DistanceGeneration, TileIndex) ? Backpointer[TileIndex] : INDEX_NONE;
+	}
+	void SetDistance(int32 TileIndex, float InDistance, int32 InBackpointer);
+
+	/* Is this tile in the 'visited' set? */
+	bool IsVisited(int32 TileIndex) const { return IsCurrent(VisitedGeneration, TileIndex); }
+	void SetVisited(int32 TileIndex);
+
+	/* Blocked tiles are never entered, e.g. tiles occupied by other pawns */
+	bool IsBlocked(int32 TileIndex) const { return IsCurrent(BlockedGeneration, TileIndex); }
+	void SetBlocked(int32 TileIndex);
+
+	/* Open set for the current search */
+	FNavGridPriorityQueue OpenSet;
+	/* Number of tiles expanded in the current search */
+	int32 NumExpanded = 0;
+
+private:
+	bool IsCurrent(const TArray<uint32> &Stamps, int32 TileIndex) const
+	{
+		return Stamps.IsValidIndex(TileIndex) && Stamps[TileIndex] == Generation;
+	}
+	/* Make sure every buffer can hold at least NumTiles entries */
+	void Grow(int32 NumTiles);
+
+	/* Stamps are zeroed when the buffers grow, so generation zero is never current */
+	uint32 Generation = 1;
+	TArray<float> Distance;
+	TArray<int32> Backpointer;
+	TArray<uint32> DistanceGeneration;
+	TArray<uint32> VisitedGeneration;
+	TArray<uint32> BlockedGeneration;
+};
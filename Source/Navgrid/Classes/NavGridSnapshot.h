@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "NavGridSearchContext.h"
+
+class ANavGrid;
+
+/**
+* Parameters for a search on a FNavGridSnapshot
+*/
+struct NAVGRID_API FNavGridQueryParams
+{
+	int32 StartIndex = INDEX_NONE;
+	/* INDEX_NONE to find every tile within MaxCost */
+	int32 TargetIndex = INDEX_NONE;
+	/* Negative for no limit */
+	float MaxCost = -1;
+	int32 Profile = INDEX_NONE;
+	/* FGridMovementModes::Mask of the pawn */
+	uint32 MovementModeMask = 0;
+	/* Tiles that can not be entered, e.g. because they are occupied by other pawns */
+	TArray<int32> BlockedTiles;
+};
+
+/**
+* Read-only copy of the tiles and baked edges of a ANavGrid.
+*
+* Tiles are only referenced through their TileIndex, so a snapshot can be searched from any thread while the
+* game thread keeps modifying the grid. Tiles are copied from their FNavGridTileRecord.
+*/
+class NAVGRID_API FNavGridSnapshot
+{
+public:
+	/* Copy Grid. Must be called on the game thread */
+	explicit FNavGridSnapshot(const ANavGrid &Grid);
+
+	/* One bit per capsule profile, set if every tile in the snapshot has up to date edges for that profile */
+	uint32 GetBakedProfiles() const { return BakedProfiles; }
+	/* Location of the tile when the snapshot was made */
+	const FVector &GetLocation(int32 TileIndex) const { return Locations[TileIndex]; }
+
+	/*
+	* Do a range search, or a path search if Params.TargetIndex is set. Can be called from any thread.
+	*
+	* OutTiles - the path from start to target for path searches, or every tile within range except the start tile for range searches
+	*
+	* Returns false if bCancelled was set during the search, or if a path search did not find a path
+	*/
+	bool Search(const FNavGridQueryParams &Params, const FThreadSafeBool &bCancelled, FNavGridSearchContext &Context, TArray<int32> &OutTiles) const;
+
+private:
+	float EstimateCost(int32 From, int32 To) const;
+
+	TArray<FVector> Locations;
+	TArray<float> Costs;
+	/* FNavGridTileRecord::TraversableMasks of each tile */
+	TArray<uint32> TraversableMasks;
+	/* Edges of tile N are EdgeTargets[EdgeOffsets[N]] to EdgeTargets[EdgeOffsets[N + 1] - 1] */
+	TArray<int32> EdgeOffsets;
+	TArray<int32> EdgeTargets;
+	TArray<uint32> EdgeObstructedProfiles;
+	uint32 BakedProfiles = 0;
+	/* Used by the heuristic, see ANavGrid::EstimateCost() */
+	float MinTileCost = 0;
+	float MaxStepLength = 1;
+};
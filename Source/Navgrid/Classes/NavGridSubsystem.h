@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavGridSubsystem.generated.h"
+
+class ANavGrid;
+class UNavTileComponent;
+
+/**
+* Keeps track of the grid tiles register with, so neither tiles nor the game state have to search the world for it.
+*
+* Tiles registered before any grid exists are remembered and handed to the first grid that shows up.
+*/
+UCLASS()
+class NAVGRID_API UNavGridSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	/* The grid tiles in this world belong to, NULL if there is none */
+	ANavGrid *GetGrid() const;
+	/* Called by ANavGrid once its components are registered. The first grid is used, and it picks up every waiting tile */
+	void AddGrid(ANavGrid &InGrid);
+	/* Remember a tile that was registered while there was no grid */
+	void AddOrphanTile(UNavTileComponent &Tile);
+
+protected:
+	TWeakObjectPtr<ANavGrid> Grid;
+	TSet<TWeakObjectPtr<UNavTileComponent>> OrphanTiles;
+};
@@ -14,9 +14,9 @@ public:
 
 	virtual void SetGrid(ANavGrid *InGrid) override;
 	virtual FVector GetPawnLocation() const override { return ToWorldSpace(FVector(TileSize / 4, 0, 25)); }
-	virtual void GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed) override;
-	virtual bool Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule) const override;
-	virtual void AddPathSegments(USplineComponent &OutSpline, TArray<FPathSegment> &OutPathSegments, bool EndTile) const override;
+	virtual void GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam) override;
+	virtual bool Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam) const override;
+	virtual void AddPathSegments(FGridPathBuilder &Builder, bool EndTile) const override;
 
 	virtual FVector GetSplineMeshUpVector() override;
 protected:
@@ -9,6 +9,61 @@
 
 #include "NavTileComponent.generated.h"
 
+class UNavTileComponent;
+class FGridPathBuilder;
+
+/**
+* A baked connection to a neighbouring tile
+*/
+struct FNavTileEdge
+{
+	/* Index of the neighbouring tile in ANavGrid */
+	int32 TileIndex = INDEX_NONE;
+	/* One bit per capsule profile in ANavGrid. Set if moving along this edge is obstructed for that profile */
+	uint32 ObstructedProfiles = 0;
+};
+
+/**
+* Everything ANavGrid knows about a tile. Searches and picking only read these, see ANavGrid::GetTileRecord().
+* Tiles placed in the level fill it in with UNavTileComponent::GetTileRecord(). Virtual tiles only exist as a record,
+* the grid creates a component for them when one is asked for, see ANavGrid::GetTileByIndex()
+*/
+struct NAVGRID_API FNavGridTileRecord
+{
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	/* Box extent, including the scale of the tile */
+	FVector Extent = FVector::ZeroVector;
+	/* World space bounding box */
+	FBox Bounds = FBox(ForceInit);
+	/* GetPawnLocation() relative to Location */
+	FVector PawnOffset = FVector::ZeroVector;
+	float Cost = 1;
+	/* Bit N is set if UNavTileComponent::Traversable() is true for pawns whose FGridMovementModes::Mask is N */
+	uint32 TraversableMasks = 0;
+
+	/* Neighbours with precomputed obstruction flags. Managed by ANavGrid::GetTileEdges() */
+	TArray<FNavTileEdge> Edges;
+	/* One bit per capsule profile in ANavGrid. Set if Edges are up to date for that profile */
+	uint32 BakedProfiles = 0;
+	/* Cells this tile occupies in the spatial index of the grid. Only valid if bSpatiallyIndexed is set */
+	FIntRect SpatialCells;
+	bool bSpatiallyIndexed = false;
+	/* Set while the index is in use */
+	bool bRegistered = false;
+	/* Set for virtual tiles, they may be evicted to make room for others */
+	bool bVirtual = false;
+	/* GFrameCounter when this tile was last placed or traced by ANavGrid. Used to pick virtual tiles for eviction */
+	uint64 LastVirtualTileUse = 0;
+
+	/* Mark Edges as stale so they are rebuilt the next time they are needed */
+	void InvalidateEdges() { BakedProfiles = 0; }
+	FVector GetPawnLocation() const { return Location + PawnOffset; }
+	/* Number of masks TraversableMasks has room for, one per combination of EGridMovementModes */
+	static constexpr uint32 NumMovementModeMasks = 32;
+	/* Bit to test TraversableMasks against for a pawn with these movement modes */
+	static uint32 GetTraversableBit(uint32 PawnMovementModeMask) { return PawnMovementModeMask < NumMovementModeMasks ? 1u << PawnMovementModeMask : 0; }
+};
 
 /**
 * A single tile in a navigation grid
@@ -19,6 +74,14 @@ class NAVGRID_API UNavTileComponent : public UBoxComponent
 	GENERATED_BODY()
 public:
 	UNavTileComponent();
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport = ETeleportType::None) override;
+	virtual void Serialize(FArchive &Ar) override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
+#endif // WITH_EDITOR
 
 protected:
 	UPROPERTY(Transient)
@@ -28,35 +91,73 @@ public:
 	ANavGrid* GetGrid() const;
 
 // Pathing
-	/* Cost of moving into this tile*/
-	UPROPERTY(BlueprintReadWrite, EditAnyWhere, Category = "Pathfinding")
+	/* Change Cost and copy it to the grid */
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void SetCost(float InCost);
+	float GetCost() const { return Cost; }
+protected:
+	/* Cost of moving into this tile. Changed through SetCost(), so the grid always sees the new value */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, BlueprintSetter = SetCost, Category = "Pathfinding")
 	float Cost = 1;
-	/* Distance from starting point of path */
-	float Distance;
-	/* Previous tile in path */
+public:
+	/* Search state used to live on the tile. These forward to the latest range search of the grid, see FNavGridSearchContext */
+	UE_DEPRECATED(4.24, "Use ANavGrid::GetDistance() instead")
+	float GetDistance() const;
+	UE_DEPRECATED(4.24, "Use ANavGrid::GetBackpointer() instead")
+	UNavTileComponent *GetBackpointer() const;
+	UE_DEPRECATED(4.24, "Use ANavGrid::IsVisited() instead")
+	bool IsVisited() const;
+	UE_DEPRECATED(4.24, "Search state is reset by FNavGridSearchContext::Reset(), this is no longer called")
+	virtual void Reset() {}
+	/* Index of this tile in the grid it belongs to. Stable for as long as the tile is registered. Used to look up per-search data in FNavGridSearchContext */
+	int32 TileIndex = INDEX_NONE;
+
+	/* movement modes that are legal (or make sense) for this tile. Blueprints change them through SetMovementModeFlags(), use it from C++ as well so the grid sees the new value */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite, BlueprintSetter = SetMovementModeFlags, Category = "Pathfinding")
+	FGridMovementModes MovementModeFlags;
+	/* Saved before MovementModeFlags existed. Converted in PostLoad(), see FNavGridCustomVersion::MovementModeFlags */
 	UPROPERTY()
-	UNavTileComponent *Backpointer;
-	/* Is this node in the 'visited' set? - Helper var for pathfinding */
-	bool Visited;
-	/* Rest temporary data (like distance and other vars used in pathfinding) */
-	virtual void Reset();
-
-	/* movement modes that are legal (or make sense) for this tile */
-	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
-	TSet<EGridMovementMode> MovementModes;
-
-	/* is there anything blocking an actor from moving from FromPos to this tile? Uses the capsule for collision testing */
-	virtual bool Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule) const;
+	TSet<EGridMovementMode> MovementModes_DEPRECATED;
+	/* Change MovementModeFlags and copy them to the grid */
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void SetMovementModeFlags(const FGridMovementModes &InMovementModes);
+	UFUNCTION(BlueprintPure, Category = "Pathfinding")
+	TSet<EGridMovementMode> GetMovementModes() const { return MovementModeFlags.ToSet(); }
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void SetMovementModes(const TSet<EGridMovementMode> &InMovementModes);
+
+	/* Fill in the data the grid uses for pathfinding and picking */
+	virtual void GetTileRecord(FNavGridTileRecord &OutRecord) const;
+	/* Fill in the part of the record that depends on the transform of this tile. Transform changes only copy this to the grid */
+	void GetTilePlacement(FNavGridTileRecord &OutRecord) const;
+	/*
+	* Copy Cost, MovementModeFlags, the answers of Traversable() and the placement of this tile to the grid.
+	* SetCost(), SetMovementModeFlags() and SetPawnLocationOffset() do this already. Call it if anything else Traversable() depends on changes
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Pathfinding")
+	void UpdateTileRecord();
+
+	/* is there anything blocking an actor from moving from FromPos to this tile? Uses the capsule for collision testing
+	* ResponseParams: overrides the responses of the sweep, ANavGrid passes GetBakeResponseParams() when baking edges
+	*/
+	virtual bool Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam) const;
 	/* is there anything blocking an actor from moving between From and To? Uses the capsule for collision testing */
-	virtual bool Obstructed(const FVector &From, const FVector &To, const UCapsuleComponent &CollisionCapsule) const;
-	virtual void GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed);
+	virtual bool Obstructed(const FVector &From, const FVector &To, const UCapsuleComponent &CollisionCapsule, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam) const;
+	/* Find neighbouring tiles with physics queries. Only tiles with a component are found, ANavGrid looks up the tiles that only exist as a record itself */
+	virtual void GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam);
 	/* Return the neighbours that are not Obstructed() */
-	void GetUnobstructedNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutNeighbours);
-	/* Can a pawn traverse this tile?
+	void GetUnobstructedNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutNeighbours, const FCollisionResponseParams &ResponseParams = FCollisionResponseParams::DefaultResponseParam);
+
+	/* Can a pawn traverse this tile? Pathfinding does not call this directly, GetTileRecord() stores the answer for every combination of movement modes
 	* PawnMovementModes: movement modes availabe for the pawn
 	*/
-	virtual bool Traversable(const TSet<EGridMovementMode> &PawnMovementModes) const;
+	virtual bool Traversable(const FGridMovementModes &PawnMovementModes) const;
 	/* Can a pawn end its turn on this tile?*/
+	virtual bool LegalPositionAtEndOfTurn(const FGridMovementModes &PawnMovementModes) const;
+	/* The signatures used before FGridMovementModes. The default implementations above call these, so existing overrides keep working */
+	UE_DEPRECATED(4.24, "Override Traversable(const FGridMovementModes &) instead")
+	virtual bool Traversable(const TSet<EGridMovementMode> &PawnMovementModes) const;
+	UE_DEPRECATED(4.24, "Override LegalPositionAtEndOfTurn(const FGridMovementModes &) instead")
 	virtual bool LegalPositionAtEndOfTurn(const TSet<EGridMovementMode> &PawnMovementModes) const;
 
 	/* Placement for pawn occupying this tile in world space */
@@ -87,16 +188,17 @@ public:
 	/*
 	* Add points for moving into this tile from FromPos
 	*
-	* OutSpline - the spline to add the points to
-	* OutPathSegments - the array we should add our path segment to
+	* Builder - the path so far, add our spline points and path segment to it
 	* EndTile - true if this is the last tile in the path
 	*/
-	virtual void AddPathSegments(USplineComponent &OutSpline, TArray<FPathSegment> &OutPathSegments, bool EndTile) const;
+	virtual void AddPathSegments(FGridPathBuilder &Builder, bool EndTile) const;
 	/* Return a suitable upvector for a splinemesh moving across this tile */
 	virtual FVector GetSplineMeshUpVector();
 
-	/* Set a highlight for this tile */
+	/* Set a highlight for this tile. Highlights are batched by the grid and shown at the end of the frame */
 	virtual void SetHighlight(FName NewHighlightType);
+	/* Transform of the highlight instance for this tile. MeshSize is the size of the highlight mesh */
+	virtual FTransform GetHighlightTransform(const FVector &MeshSize) const;
 	/* draw debug information on the screen*/
 	virtual void DrawDebug(UCapsuleComponent *CollisionCapsule, bool bPersistentLines, float LifeTime, float Thickness);
 };
\ No newline at end of file
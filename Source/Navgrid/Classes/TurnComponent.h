@@ -27,13 +27,20 @@ protected:
 	void OnTurnTimeout();
 	FTimerHandle TurnTimeoutHandle;
 public:
-	/* The number of actions this pawn can perform in a single round */
+	/* The number of actions this pawn can perform in a single round, or in a single turn with ETurnOrder::Initiative */
 	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
 	int32 StartingActionPoints;
-	/* Remaining actions that this pawn can perform this round */
+	/* Remaining actions that this pawn can perform this round, or this turn with ETurnOrder::Initiative */
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	int32 RemainingActionPoints;
 
+	/* How often this component gets a turn when the turn manager uses ETurnOrder::Initiative. A turn comes up every 1 / Speed units of initiative time and a round lasts one unit, so twice the speed means twice as many turns per round */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
+	float Speed;
+	/* Initiative time of the next turn for this component. Components act in order of this, and every turn adds 1 / Speed */
+	UPROPERTY(VisibleAnyWhere, BlueprintReadOnly)
+	float InitiativeTime;
+
 	/* end this turn after the given amount of time has passed. Set to 0 to disable */
 	UPROPERTY(VisibleAnyWhere, BlueprintReadWrite)
 	float TurnTimeout;
@@ -70,4 +77,12 @@ public:
 	// called by the turn manager
 	void OnTurnStart();
 	void OnTurnEnd();
+
+private:
+	friend class ATurnManager;
+	/* The team we registered with, and our index in its FTurnManagerTeam::Members. Set by the turn manager */
+	FGenericTeamId RosterTeamId;
+	int32 RosterIndex = INDEX_NONE;
+	/* Our node in ATurnManager::InitiativeQueue */
+	int32 InitiativeSlot = INDEX_NONE;
 };
\ No newline at end of file
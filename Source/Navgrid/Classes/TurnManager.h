@@ -4,6 +4,7 @@
 
 #include "GameFramework/Actor.h"
 #include "GenericTeamAgentInterface.h"
+#include "NavGridPriorityQueue.h"
 #include "TurnManager.generated.h"
 
 class UTurnComponent;
@@ -17,12 +18,42 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnReadyForInput, UTurnComponent *,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnRoundStart);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnRoundEnd);
 
+/* How ATurnManager decides who gets the next turn */
+UENUM(BlueprintType)
+enum class ETurnOrder : uint8
+{
+	/* Each team acts in turn, ordered by team id. Members of a team take turns round robin */
+	Team,
+	/* Every component acts when its initiative time comes up, regardless of team. A round lasts one unit of initiative time. See UTurnComponent::Speed */
+	Initiative
+};
+
+/**
+* The members of a single team, in the order they registered
+*/
+USTRUCT()
+struct NAVGRID_API FTurnManagerTeam
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FGenericTeamId TeamId;
+	UPROPERTY()
+	TArray<UTurnComponent *> Members;
+	/* Index in Members of the component that most recently started a turn, INDEX_NONE at the start of a round */
+	int32 Cursor = INDEX_NONE;
+};
+
 /**
 * Coordinates a set of turn components.
 *
 * Terms:
 *  'Turn' is used for a singe pawn doing a single action.
 *  'Round' is used for all pawns managed by this turn manager having their Turn.
+*
+* The turn manager does not tick. Ending a turn or requesting a new one schedules a single turn
+* transition for the next frame, and the next component is found by going round robin through the
+* members of each team, starting from the one that had the last turn.
 */
 UCLASS(BlueprintType, Blueprintable, NotPlaceable)
 class NAVGRID_API ATurnManager : public AActor
@@ -30,7 +61,7 @@ class NAVGRID_API ATurnManager : public AActor
 	GENERATED_BODY()
 public:
 	ATurnManager();
-	virtual void Tick(float DeltaTime) override;
+	virtual void BeginPlay() override;
 
 	/* Add a turn component to be managed */
 	UFUNCTION(BlueprintCallable)
@@ -41,6 +72,21 @@ public:
 	/* minumuim number of teams needed to start a new turn */
 	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
 	int32 MinNumberOfTeams;
+	/* How the next component to act is chosen. Can be changed at any time */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
+	ETurnOrder TurnOrder;
+	/* Headless simulation. Turns are only started by SimulateTurns() and turn timeouts are disabled */
+	UPROPERTY(EditAnyWhere, BlueprintReadWrite)
+	bool bSimulate;
+
+	/* Start turns right away until MaxTurns turns have started or no new turn has been requested. Returns the number of turns started */
+	UFUNCTION(BlueprintCallable)
+	int32 SimulateTurns(int32 MaxTurns);
+	/* Would a new turn start if it was the next frame */
+	bool IsTurnPending() const { return bStartNewTurn && Teams.Num() >= MinNumberOfTeams; }
+	/* Number of teams with at least one registered component */
+	UFUNCTION(BlueprintPure)
+	int32 GetNumTeams() const { return Teams.Num(); }
 
 	/* End the turn for the current turn component */
 	UFUNCTION(BlueprintCallable)
@@ -68,8 +114,22 @@ public:
 protected:
 	// find the next team member that can act this turn
 	UTurnComponent *FindNextTeamMember(const FGenericTeamId &TeamId);
-	UTurnComponent *FindNextComponent();
+	UTurnComponent *FindNextTeamMember(const FTurnManagerTeam &Team) const;
+	/* The component that should act next according to TurnOrder, nullptr if no one can act this round */
+	virtual UTurnComponent *FindNextComponent();
+	/* The queued component with the lowest initiative time */
+	UTurnComponent *FindNextInitiative();
+	/* Give Component its place in the initiative queue after acting */
+	void RequeueInitiative(UTurnComponent &Component);
 	bool HasComponentsThatCanAct();
+	/* Team with a given id, nullptr if it has no registered members */
+	FTurnManagerTeam *FindTeam(const FGenericTeamId &TeamId);
+
+	/* End the current turn and start the next one during the next frame */
+	void ScheduleTurnTransition();
+	/* Called by the timer set in ScheduleTurnTransition() */
+	void OnTurnTransitionTimer();
+	void StartNewTurn();
 
 private:
 	UPROPERTY(BlueprintAssignable)
@@ -101,8 +161,21 @@ protected:
 	UTurnComponent *CurrentComponent;
 	UPROPERTY()
 	UTurnComponent *NextComponent;
-	TMultiMap<FGenericTeamId, UTurnComponent *> Teams;
+	/* Every team with at least one member, sorted by team id */
+	UPROPERTY()
+	TArray<FTurnManagerTeam> Teams;
 	UPROPERTY(VisibleAnyWhere)
 	int32 Round;
 	bool bStartNewTurn;
+	/* Is StartNewTurn() set to run next frame */
+	bool bTransitionScheduled;
+
+	/* Every registered component, indexed by UTurnComponent::InitiativeSlot. Removed components leave NULL entries that are reused */
+	UPROPERTY()
+	TArray<UTurnComponent *> InitiativeSlots;
+	TArray<int32> FreeInitiativeSlots;
+	/* Slots of every registered component except the current one, keyed on UTurnComponent::InitiativeTime. Exhausted components are dropped lazily */
+	FNavGridPriorityQueue InitiativeQueue;
+	/* Initiative time of the last component that started a turn */
+	float InitiativeClock;
 };
\ No newline at end of file
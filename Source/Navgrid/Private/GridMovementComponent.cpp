@@ -2,12 +2,54 @@
 
 #include "GridMovementComponent.h"
 #include "NavGridPrivatePCH.h"
+#include "GridPathBuilder.h"
+#include "GridPathSamples.h"
+#include "GridMovementSubsystem.h"
 
 #include "Components/SplineComponent.h"
 #include "Components/SplineMeshComponent.h"
 #include "Animation/AnimInstance.h"
+#include "Serialization/CustomVersion.h"
 
-FPathSegment::FPathSegment(TSet<EGridMovementMode> InMovementModes, float InStart, float InEnd)
+const FGuid FNavGridCustomVersion::GUID(0x5A4C0E1B, 0x7D9346F2, 0x9B3E21C8, 0x4F6A0D57);
+static FCustomVersionRegistration GRegisterNavGridCustomVersion(FNavGridCustomVersion::GUID, FNavGridCustomVersion::LatestVersion, TEXT("NavGridVer"));
+
+bool FNavGridCustomVersion::NeedsConversion(const UObject &Object, Type Version)
+{
+	// packages saved before the custom version was added report -1
+	return Object.GetLinker() && Object.GetLinkerCustomVersion(GUID) < Version;
+}
+
+FGridMovementModes::FGridMovementModes(std::initializer_list<EGridMovementMode> InModes)
+{
+	for (EGridMovementMode Mode : InModes)
+	{
+		Add(Mode);
+	}
+}
+
+FGridMovementModes::FGridMovementModes(const TSet<EGridMovementMode> &InModes)
+{
+	for (EGridMovementMode Mode : InModes)
+	{
+		Add(Mode);
+	}
+}
+
+TSet<EGridMovementMode> FGridMovementModes::ToSet() const
+{
+	TSet<EGridMovementMode> Modes;
+	for (int32 Bit = 0; Bit < 32; Bit++)
+	{
+		if (Mask & (1 << Bit))
+		{
+			Modes.Add((EGridMovementMode)Bit);
+		}
+	}
+	return Modes;
+}
+
+FPathSegment::FPathSegment(const FGridMovementModes &InMovementModes, float InStart, float InEnd)
 {
 	MovementModes = InMovementModes;
 	Start = InStart;
@@ -19,11 +61,13 @@ UGridMovementComponent::UGridMovementComponent(const FObjectInitializer &ObjectI
 {
 	PathMesh = ConstructorHelpers::FObjectFinder<UStaticMesh>(TEXT("StaticMesh'/NavGrid/SMesh/NavGrid_Path.NavGrid_Path'")).Object;
 
-	AvailableMovementModes.Add(EGridMovementMode::ClimbingDown);
-	AvailableMovementModes.Add(EGridMovementMode::ClimbingUp);
-	AvailableMovementModes.Add(EGridMovementMode::Stationary);
-	AvailableMovementModes.Add(EGridMovementMode::Walking);
-	AvailableMovementModes.Add(EGridMovementMode::InPlaceTurn);
+	AvailableMovementModeFlags.Add(EGridMovementMode::ClimbingDown);
+	AvailableMovementModeFlags.Add(EGridMovementMode::ClimbingUp);
+	AvailableMovementModeFlags.Add(EGridMovementMode::Stationary);
+	AvailableMovementModeFlags.Add(EGridMovementMode::Walking);
+	AvailableMovementModeFlags.Add(EGridMovementMode::InPlaceTurn);
+	// the old default, kept for data that did not save the set because it was not changed
+	AvailableMovementModes_DEPRECATED = AvailableMovementModeFlags.ToSet();
 
 	Distance = 0;
 	MovementMode = EGridMovementMode::Stationary;
@@ -46,6 +90,17 @@ void UGridMovementComponent::BeginPlay()
 	{
 		UE_LOG(NavGrid, Error, TEXT("%s was unable to find a NavGrid in level"), *this->GetName());
 	}
+	else
+	{
+		// let the grid know where we are, see ANavGrid::GetOccupancyHash()
+		ConsiderUpdateCurrentTile();
+		// and tell it again whenever we are moved by anyone but ourselves
+		USceneComponent *OwnerRoot = GetOwner()->GetRootComponent();
+		if (OwnerRoot)
+		{
+			OwnerTransformUpdatedHandle = OwnerRoot->TransformUpdated.AddUObject(this, &UGridMovementComponent::OnOwnerTransformUpdated);
+		}
+	}
 
 	/* Grab a reference to the first AnimInstace we find */
 	TArray<USkeletalMeshComponent*> SkeletalMeshComponents;
@@ -65,25 +120,115 @@ void UGridMovementComponent::BeginPlay()
 		bUseRootMotion = false;
 		bAlwaysUseRootMotion = false;
 	}
+
+	/* Let the subsystem tick us while we are moving, and do not tick at all while we are standing still */
+	UWorld *World = GetWorld();
+	MovementSubsystem = World ? World->GetSubsystem<UGridMovementSubsystem>() : nullptr;
+	if (MovementSubsystem.IsValid())
+	{
+		SetComponentTickEnabled(false);
+		if (!CanSleep())
+		{
+			Wake();
+		}
+	}
+}
+
+void UGridMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (MovementSubsystem.IsValid())
+	{
+		MovementSubsystem->Remove(*this);
+	}
+	MovementSubsystem = nullptr;
+
+	USceneComponent *OwnerRoot = GetOwner()->GetRootComponent();
+	if (OwnerRoot && OwnerTransformUpdatedHandle.IsValid())
+	{
+		OwnerRoot->TransformUpdated.Remove(OwnerTransformUpdatedHandle);
+		OwnerTransformUpdatedHandle.Reset();
+	}
+
+	AGridPawn *GridPawnOwner = Cast<AGridPawn>(GetOwner());
+	if (IsValid(CachedNavGrid) && GridPawnOwner)
+	{
+		CachedNavGrid->ForgetRoute(GridPawnOwner);
+		CachedNavGrid->RemovePawn(*GridPawnOwner);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGridMovementComponent::Serialize(FArchive &Ar)
+{
+	Super::Serialize(Ar);
+	Ar.UsingCustomVersion(FNavGridCustomVersion::GUID);
+}
+
+void UGridMovementComponent::PostLoad()
+{
+	Super::PostLoad();
+	// AvailableMovementModes used to be saved as a TSet, see NavGridPluginImpl::StartupModule() for the redirect. An empty set is converted as well
+	if (FNavGridCustomVersion::NeedsConversion(*this, FNavGridCustomVersion::MovementModeFlags))
+	{
+		AvailableMovementModeFlags = FGridMovementModes(AvailableMovementModes_DEPRECATED);
+	}
 }
 
 void UGridMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	if (!MovementSubsystem.IsValid())
+	{
+		TickMovement(DeltaTime);
+	}
+}
+
+bool UGridMovementComponent::CanSleep() const
+{
+	return MovementMode == EGridMovementMode::Stationary && !bAlwaysUseRootMotion;
+}
+
+void UGridMovementComponent::Sleep()
+{
+	ActiveMoverIndex = INDEX_NONE;
+	Velocity = FVector::ZeroVector;
+	UpdateComponentVelocity();
+}
+
+void UGridMovementComponent::Wake()
+{
+	if (MovementSubsystem.IsValid())
+	{
+		MovementSubsystem->Wake(*this);
+	}
+}
+
+void UGridMovementComponent::TickMovement(float DeltaTime)
+{
+	if (DeltaTime <= 0)
+	{
+		return;
+	}
+
 	// if we are moving, find the current path segment
 	if (MovementMode == EGridMovementMode::Walking ||
 		MovementMode == EGridMovementMode::ClimbingDown ||
 		MovementMode == EGridMovementMode::ClimbingUp)
 	{
-		CurrentPathSegment = FPathSegment({ EGridMovementMode::Walking }, 0, Spline->GetSplineLength());
-		for (FPathSegment &Segment : PathSegments)
+		static const FGridMovementModes WalkingOnly = { EGridMovementMode::Walking };
+		while (PathSegmentCursor < PathSegments.Num() && Distance > PathSegments[PathSegmentCursor].End)
 		{
-			if (Distance >= Segment.Start && Distance <= Segment.End)
-			{
-				CurrentPathSegment = Segment;
-				break;
-			}
+			PathSegmentCursor++;
+		}
+		if (PathSegmentCursor < PathSegments.Num() && Distance >= PathSegments[PathSegmentCursor].Start)
+		{
+			CurrentPathSegment = PathSegments[PathSegmentCursor];
+		}
+		else
+		{
+			CurrentPathSegment = FPathSegment(WalkingOnly, 0, PathSamples.GetLength());
 		}
 	}
 
@@ -111,7 +256,7 @@ void UGridMovementComponent::TickComponent(float DeltaTime, enum ELevelTick Tick
 	case EGridMovementMode::ClimbingDown:
 	case EGridMovementMode::ClimbingUp:
 		NewTransform = TransformFromPath(DeltaTime);
-		ConsiderUpdateCurrentTile();
+		UpdateCurrentTileFromPath();
 		break;
 	}
 
@@ -125,6 +270,7 @@ void UGridMovementComponent::TickComponent(float DeltaTime, enum ELevelTick Tick
 	Velocity = (NewTransform.GetLocation() - Owner->GetActorLocation()) * (1 / DeltaTime);
 	UpdateComponentVelocity();
 	// actually move the the actor
+	TGuardValue<bool> MovingOwner(bMovingOwner, true);
 	Owner->SetActorTransform(NewTransform);
 }
 
@@ -155,14 +301,14 @@ FTransform UGridMovementComponent::TransformFromPath(float DeltaTime)
 		}
 	}
 
-	Distance = FMath::Min(Spline->GetSplineLength(), Distance + CurrentSpeed);
+	Distance = FMath::Min(PathSamples.GetLength(), Distance + CurrentSpeed);
 
 	/* Grab our current transform so we can find the velocity if we need it later */
 	AActor *Owner = GetOwner();
 	FTransform OldTransform = Owner->GetTransform();
 
 	/* Find the next location and rotation from the spline*/
-	FTransform NewTransform = Spline->GetTransformAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local);
+	FTransform NewTransform = PathSamples.GetTransform(Distance);
 	FRotator DesiredRotation;
 
 	/* Restrain rotation axis if we're walking */
@@ -181,7 +327,7 @@ FTransform UGridMovementComponent::TransformFromPath(float DeltaTime)
 	NewTransform.SetRotation(NewRotation.Quaternion());
 
 	// check if we are done
-	if (Distance >= Spline->GetSplineLength())
+	if (Distance >= PathSamples.GetLength())
 	{
 		FinishMovement();
 	}
@@ -216,26 +362,69 @@ void UGridMovementComponent::ConsiderUpdateCurrentTile()
 
 		UNavTileComponent *Tile = Grid->GetTile(GetOwner()->GetActorLocation(), true);
 		if (!Tile &&
-			(AvailableMovementModes.Contains(EGridMovementMode::ClimbingDown) ||
-				AvailableMovementModes.Contains(EGridMovementMode::ClimbingUp)))
+			(AvailableMovementModeFlags.Contains(EGridMovementMode::ClimbingDown) ||
+				AvailableMovementModeFlags.Contains(EGridMovementMode::ClimbingUp)))
 		{
 			Tile = Grid->GetTile(GetOwner()->GetActorLocation(), false);
 		}
 
-		if (IsValid(Tile) && Tile != CurrentTile)
+		if (IsValid(Tile))
 		{
-			CurrentTile = Tile;
+			SetCurrentTile(Tile);
+		}
+	}
+}
 
-			ANavGridGameState *GameState = Cast<ANavGridGameState>(UGameplayStatics::GetGameState(GetOwner()));
-			if (IsValid(GameState))
-			{
-				AGridPawn *GridPawn = Cast<AGridPawn>(GetOwner());
-				GameState->OnPawnEnterTile().Broadcast(GridPawn, CurrentTile);
-			}
+void UGridMovementComponent::UpdateCurrentTileFromPath()
+{
+	if (!PathTiles.Num())
+	{
+		ConsiderUpdateCurrentTile();
+		return;
+	}
+	while (PathTileCursor < PathTiles.Num() && Distance >= PathTileEnterDistances[PathTileCursor])
+	{
+		UNavTileComponent *Tile = PathTiles[PathTileCursor++];
+		if (IsValid(Tile))
+		{
+			SetCurrentTile(Tile);
 		}
 	}
 }
 
+void UGridMovementComponent::OnOwnerTransformUpdated(USceneComponent *UpdatedRoot, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (!bMovingOwner)
+	{
+		ConsiderUpdateCurrentTile();
+	}
+}
+
+void UGridMovementComponent::SetCurrentTile(UNavTileComponent *Tile)
+{
+	if (Tile == CurrentTile)
+	{
+		return;
+	}
+	CurrentTile = Tile;
+
+	AGridPawn *GridPawnOwner = Cast<AGridPawn>(GetOwner());
+	ANavGrid *Grid = GetNavGrid();
+	if (IsValid(Grid) && GridPawnOwner)
+	{
+		Grid->SetPawnTile(*GridPawnOwner, CurrentTile);
+	}
+
+	if (!CachedGameState.IsValid())
+	{
+		CachedGameState = Cast<ANavGridGameState>(UGameplayStatics::GetGameState(GetOwner()));
+	}
+	if (CachedGameState.IsValid())
+	{
+		CachedGameState->OnPawnEnterTile().Broadcast(GridPawnOwner, CurrentTile);
+	}
+}
+
 void UGridMovementComponent::GetTilesInRange(TArray<UNavTileComponent *> &OutTiles)
 {
 	ANavGrid *Grid = GetNavGrid();
@@ -308,6 +497,11 @@ void UGridMovementComponent::StringPull(TArray<const UNavTileComponent*>& InPath
 }
 
 bool UGridMovementComponent::CreatePath(const UNavTileComponent &Target)
+{
+	return CreatePath(Target, MovementRange);
+}
+
+bool UGridMovementComponent::CreatePath(const UNavTileComponent &Target, float MaxCost)
 {
 	QUICK_SCOPE_CYCLE_COUNTER(STAT_UGridMovementComponent_CreatePath);
 	AGridPawn *Owner = Cast<AGridPawn>(GetOwner());
@@ -319,54 +513,133 @@ bool UGridMovementComponent::CreatePath(const UNavTileComponent &Target)
 	}
 
 	ANavGrid* Grid = GetNavGrid();
-	TArray<UNavTileComponent *> InRange;
-	Grid->GetTilesInRange(Cast<AGridPawn>(GetOwner()), InRange);
-	if (InRange.Contains(&Target))
+	TArray<int32> PathIndices;
+	if (Grid->FindPath(Owner, Target, MaxCost, PathIndices))
 	{
-		// create a list of tiles from the destination to the starting point and reverse it
 		TArray<const UNavTileComponent *> Path;
-		const UNavTileComponent *Current = &Target;
-		while (Current)
+		for (int32 Index : PathIndices)
 		{
-			Path.Add(Current);
-			Current = Current->Backpointer;
+			Path.Add(Grid->GetTileByIndex(Index));
 		}
-		if (bStringPullPath)
+		return CreatePathFromTiles(Path);
+	}
+
+	return false; // no path to TargetTile
+}
+
+bool UGridMovementComponent::CreatePathFromTiles(TArray<const UNavTileComponent *> Path)
+{
+	ANavGrid* Grid = GetNavGrid();
+	// the pawn still moves through tiles that are skipped by string pulling, keep them for UpdateCurrentTileFromPath()
+	const TArray<const UNavTileComponent *> UnpulledPath = Path;
+	if (bInstantMovement)
+	{
+		// the path is neither shown nor followed, so we only need to know where it ends
+		PathTiles.Reset();
+		for (int32 Idx = 1; Idx < UnpulledPath.Num(); Idx++)
 		{
-			TArray<const UNavTileComponent *> StringPulledPath;
-			StringPull(Path, StringPulledPath);
-			Path = StringPulledPath;
+			if (UnpulledPath[Idx] != CurrentTile)
+			{
+				PathTiles.Add(const_cast<UNavTileComponent *>(UnpulledPath[Idx]));
+			}
 		}
+		return Path.Num() > 1;
+	}
+	if (bStringPullPath)
+	{
+		// StringPull() expects the path to go from the destination to the starting point
 		Algo::Reverse(Path);
+		TArray<const UNavTileComponent *> StringPulledPath;
+		StringPull(Path, StringPulledPath);
+		Path = StringPulledPath;
+		Algo::Reverse(Path);
+	}
 
-		// Build the path spline and path segments
-		Spline->ClearSplinePoints();
-		PathSegments.Empty();
-		if (Path.Num() > 1)
-		{
-			FVector ActorLocation = GetOwner()->GetActorLocation();
-			// use the actor location inststead of the tile location for the first spline point
-			Spline->AddSplinePoint(ActorLocation, ESplineCoordinateSpace::Local);
-			Spline->SetSplinePointType(0, ESplinePointType::Linear, false);
+	// Build the path spline and path segments
+	FGridPathBuilder Builder;
+	if (Path.Num() > 1)
+	{
+		FVector ActorLocation = GetOwner()->GetActorLocation();
+		const UNavTileComponent *ActorTile = Grid->GetTile(ActorLocation);
+		// use the actor location inststead of the tile location for the first spline point
+		Builder.AddPoint(ActorLocation, ESplinePointType::Linear);
 
-			for (int32 Idx = 1; Idx < Path.Num(); Idx++)
+		for (int32 Idx = 1; Idx < Path.Num(); Idx++)
+		{
+			if (ActorTile != Path[Idx] && CurrentTile != Path[Idx])
 			{
-				if (Grid->GetTile(ActorLocation) != Path[Idx] && CurrentTile != Path[Idx])
-				{
-					Path[Idx]->AddPathSegments(*Spline, PathSegments, Idx == Path.Num() - 1);
-				}
+				Path[Idx]->AddPathSegments(Builder, Idx == Path.Num() - 1);
+			}
+		}
+	}
+	Builder.Build(*Spline, PathSegments);
+	PathSamples.Build(*Spline, PathSampleSpacing);
+	PathSegmentCursor = 0;
+
+	// each tile is entered halfway between where the path passes the previous tile and where it passes this one
+	PathTiles.Reset();
+	PathTileEnterDistances.Reset();
+	PathTileCursor = 0;
+	if (Path.Num() > 1)
+	{
+		int32 Sample = 0;
+		float PreviousDistance = 0;
+		for (int32 Idx = 1; Idx < UnpulledPath.Num(); Idx++)
+		{
+			const UNavTileComponent *Tile = UnpulledPath[Idx];
+			if (Tile == CurrentTile)
+			{
+				continue;
 			}
-			return true; // success!
+			float TileDistance = PathSamples.FindClosestDistance(Tile->GetPawnLocation(), Sample);
+			PathTiles.Add(const_cast<UNavTileComponent *>(Tile));
+			PathTileEnterDistances.Add((PreviousDistance + TileDistance) / 2);
+			PreviousDistance = TileDistance;
 		}
 	}
 
-	return false; // no path to TargetTile
+	return Path.Num() > 1;
+}
+
+bool UGridMovementComponent::MoveTowards(UNavTileComponent &Target)
+{
+	ANavGrid *Grid = GetNavGrid();
+	AGridPawn *Owner = Cast<AGridPawn>(GetOwner());
+	FNavGridRoute Route;
+	if (!IsValid(Grid) || !Grid->PlanRoute(Owner, &Target, Route))
+	{
+		return false;
+	}
+
+	TArray<const UNavTileComponent *> Leg;
+	Route.GetLeg(0, Leg);
+	bool PathExists = CreatePathFromTiles(Leg);
+	if (PathExists && bInstantMovement)
+	{
+		JumpToPathEnd();
+	}
+	else if (PathExists)
+	{
+		ChangeMovementMode(EGridMovementMode::Walking);
+	}
+	return PathExists;
 }
 
 bool UGridMovementComponent::MoveTo(const UNavTileComponent &Target)
 {
+	ANavGrid *Grid = GetNavGrid();
+	if (IsValid(Grid) && Grid->EnableVirtualTiles)
+	{
+		// make sure every virtual tile has been placed around us before committing to a path. This is cached, so it is usually free
+		TArray<UNavTileComponent *> InRange;
+		Grid->GetCompleteTilesInRange(Cast<AGridPawn>(GetOwner()), InRange);
+	}
 	bool PathExists = CreatePath(Target);
-	if (PathExists)
+	if (PathExists && bInstantMovement)
+	{
+		JumpToPathEnd();
+	}
+	else if (PathExists)
 	{
 		ChangeMovementMode(EGridMovementMode::Walking);
 	}
@@ -375,7 +648,11 @@ bool UGridMovementComponent::MoveTo(const UNavTileComponent &Target)
 
 void UGridMovementComponent::TurnTo(const FRotator & Forward)
 {
-	if (AvailableMovementModes.Contains(EGridMovementMode::InPlaceTurn))
+	if (AvailableMovementModeFlags.Contains(EGridMovementMode::InPlaceTurn) && bInstantMovement)
+	{
+		GetOwner()->SetActorRotation(ApplyRotationLocks(Forward));
+	}
+	else if (AvailableMovementModeFlags.Contains(EGridMovementMode::InPlaceTurn))
 	{
 		DesiredForwardRotation = Forward;
 		ChangeMovementMode(EGridMovementMode::InPlaceTurn);
@@ -396,12 +673,31 @@ void UGridMovementComponent::SnapToGrid()
 	}
 }
 
+void UGridMovementComponent::JumpToPathEnd()
+{
+	if (PathTiles.Num())
+	{
+		UNavTileComponent *Target = PathTiles.Last();
+		AActor *Owner = GetOwner();
+		FVector TargetLocation = Target->GetPawnLocation();
+		FRotator NewRotation = Owner->GetActorRotation();
+		FVector Delta = TargetLocation - Owner->GetActorLocation();
+		if (!Delta.IsNearlyZero())
+		{
+			NewRotation.Yaw = Delta.Rotation().Yaw;
+		}
+		Owner->SetActorLocationAndRotation(TargetLocation, ApplyRotationLocks(NewRotation));
+		SetCurrentTile(Target);
+	}
+	FinishMovement();
+}
+
 void UGridMovementComponent::AdvanceAlongPath(float InDistance)
 {
-	if (Spline->GetNumberOfSplinePoints() > 0)
+	if (!PathSamples.IsEmpty())
 	{
-		Distance = FMath::Min(Spline->GetSplineLength(), Distance + InDistance);
-		FTransform NewTransform = Spline->GetTransformAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local);
+		Distance = FMath::Min(PathSamples.GetLength(), Distance + InDistance);
+		FTransform NewTransform = PathSamples.GetTransform(Distance);
 
 		FRotator DesiredRotation;
 		/* Restrain rotation axis if we're walking */
@@ -421,14 +717,17 @@ void UGridMovementComponent::AdvanceAlongPath(float InDistance)
 		/* never change the scale */
 		NewTransform.SetScale3D(GetOwner()->GetActorScale3D());
 
-		GetOwner()->SetActorTransform(NewTransform);
-		ConsiderUpdateCurrentTile();
+		{
+			TGuardValue<bool> MovingOwner(bMovingOwner, true);
+			GetOwner()->SetActorTransform(NewTransform);
+		}
+		UpdateCurrentTileFromPath();
 	}
 }
 
 float UGridMovementComponent::GetRemainingDistance()
 {
-	return FMath::Max(Spline->GetSplineLength() - Distance, 0.0f);
+	return FMath::Max(PathSamples.GetLength() - Distance, 0.0f);
 }
 
 FRotator UGridMovementComponent::ApplyRotationLocks(const FRotator & InRotation)
@@ -443,6 +742,8 @@ FRotator UGridMovementComponent::ApplyRotationLocks(const FRotator & InRotation)
 
 void UGridMovementComponent::ShowPath()
 {
+	const int32 NumPreviouslyVisible = NumVisibleSplineMeshes;
+	NumVisibleSplineMeshes = 0;
 	if (PathMesh)
 	{
 		float PathDistance = HorizontalOffset; // Get some distance between the actor and the path
@@ -457,15 +758,21 @@ void UGridMovementComponent::ShowPath()
 			PathDistance += FMath::Min(MeshLength, SplineLength - PathDistance);
 		}
 	}
+
+	// hide whatever is left of the previous path
+	for (int32 Idx = NumVisibleSplineMeshes; Idx < NumPreviouslyVisible; Idx++)
+	{
+		SplineMeshes[Idx]->SetVisibility(false);
+	}
 }
 
 void UGridMovementComponent::HidePath()
 {
-	for (USplineMeshComponent *SMesh : SplineMeshes)
+	for (int32 Idx = 0; Idx < NumVisibleSplineMeshes; Idx++)
 	{
-		SMesh->DestroyComponent();
+		SplineMeshes[Idx]->SetVisibility(false);
 	}
-	SplineMeshes.Empty();
+	NumVisibleSplineMeshes = 0;
 }
 
 FTransform UGridMovementComponent::ConsumeRootMotion()
@@ -515,12 +822,21 @@ void UGridMovementComponent::ChangeMovementMode(EGridMovementMode NewMode)
 	{
 		OnMovementModeChangedEvent.Broadcast(MovementMode, NewMode);
 		MovementMode = NewMode;
+		if (!CanSleep())
+		{
+			Wake();
+		}
 	}
 }
 
 void UGridMovementComponent::FinishMovement()
 {
 	Distance = 0;
+	PathSegmentCursor = 0;
+	PathSamples.Reset();
+	PathTiles.Reset();
+	PathTileEnterDistances.Reset();
+	PathTileCursor = 0;
 	if (IsValid(Spline))
 	{
 		Spline->ClearSplinePoints();
@@ -531,8 +847,7 @@ void UGridMovementComponent::FinishMovement()
 
 FVector UGridMovementComponent::GetForwardLocation(float ForwardDistance)
 {
-	float D = FMath::Min(Spline->GetSplineLength(), Distance + ForwardDistance);
-	return Spline->GetLocationAtDistanceAlongSpline(D, ESplineCoordinateSpace::Local);
+	return PathSamples.GetLocation(Distance + ForwardDistance);
 }
 
 void UGridMovementComponent::AddSplineMesh(float From, float To)
@@ -549,14 +864,22 @@ void UGridMovementComponent::AddSplineMesh(float From, float To)
 	FVector UpVector = EndPos - StartPos;
 	UpVector = FVector(UpVector.Y, UpVector.Z, UpVector.X);
 
-	UPROPERTY() USplineMeshComponent *SplineMesh = NewObject<USplineMeshComponent>(this);
-	SplineMesh->SetMobility(EComponentMobility::Movable);
-	SplineMesh->SetStartAndEnd(StartPos, StartTan, EndPos, EndTan);
+	if (NumVisibleSplineMeshes == SplineMeshes.Num())
+	{
+		USplineMeshComponent *NewMesh = NewObject<USplineMeshComponent>(this);
+		NewMesh->SetMobility(EComponentMobility::Movable);
+		NewMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		NewMesh->RegisterComponentWithWorld(GetWorld());
+		SplineMeshes.Add(NewMesh);
+	}
+
+	USplineMeshComponent *SplineMesh = SplineMeshes[NumVisibleSplineMeshes++];
+	// PathMesh may have been changed since the mesh was created, this does nothing if it is the same
 	SplineMesh->SetStaticMesh(PathMesh);
-	SplineMesh->RegisterComponentWithWorld(GetWorld());
-	SplineMesh->SetSplineUpDir(UpVector);
-	SplineMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	SplineMeshes.Add(SplineMesh);
+	// only rebuild the mesh once, after the last parameter has been set
+	SplineMesh->SetStartAndEnd(StartPos, StartTan, EndPos, EndTan, false);
+	SplineMesh->SetSplineUpDir(UpVector, true);
+	SplineMesh->SetVisibility(true);
 }
 
 FRotator UGridMovementComponent::LimitRotation(const FRotator &OldRotation, const FRotator &NewRotation, float DeltaTime)
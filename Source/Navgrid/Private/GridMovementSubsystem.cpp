@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GridMovementSubsystem.h"
+#include "NavGridPrivatePCH.h"
+
+DECLARE_CYCLE_STAT(TEXT("Batch movement"), STAT_NavGrid_BatchMovement, STATGROUP_NavGrid);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active movers"), STAT_NavGrid_ActiveMovers, STATGROUP_NavGrid);
+
+void FGridMovementTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent)
+{
+	if (IsValid(Target) && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Target->Tick(DeltaTime);
+	}
+}
+
+FString FGridMovementTickFunction::DiagnosticMessage()
+{
+	return TEXT("FGridMovementTickFunction");
+}
+
+UGridMovementSubsystem::UGridMovementSubsystem()
+{
+	// same settings as UActorComponent uses for the primary component tick
+	TickFunction.TickGroup = TG_PrePhysics;
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = false;
+	TickFunction.Target = this;
+}
+
+void UGridMovementSubsystem::Wake(UGridMovementComponent &Component)
+{
+	if (Component.ActiveMoverIndex == INDEX_NONE)
+	{
+		Component.ActiveMoverIndex = ActiveMovers.Add(&Component);
+	}
+
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		UWorld *World = GetWorld();
+		if (!World || !World->PersistentLevel)
+		{
+			return;
+		}
+		TickFunction.RegisterTickFunction(World->PersistentLevel);
+	}
+	TickFunction.SetTickFunctionEnable(true);
+}
+
+void UGridMovementSubsystem::Remove(UGridMovementComponent &Component)
+{
+	if (ActiveMovers.IsValidIndex(Component.ActiveMoverIndex) && ActiveMovers[Component.ActiveMoverIndex] == &Component)
+	{
+		// we may be in the middle of Tick(), leave the slot for it to clean up
+		ActiveMovers[Component.ActiveMoverIndex] = nullptr;
+	}
+	Component.ActiveMoverIndex = INDEX_NONE;
+}
+
+void UGridMovementSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NavGrid_BatchMovement);
+
+	// movers may be woken up while we are iterating, e.g. from OnMovementEnd(). Those are appended and ticked this frame as well
+	int32 Idx = 0;
+	while (Idx < ActiveMovers.Num())
+	{
+		if (IsValid(ActiveMovers[Idx]) && ActiveMovers[Idx]->IsRegistered())
+		{
+			// actor tick functions scale by CustomTimeDilation themselves, we have to do it for them
+			AActor *Owner = ActiveMovers[Idx]->GetOwner();
+			ActiveMovers[Idx]->TickMovement(Owner ? DeltaTime * Owner->CustomTimeDilation : DeltaTime);
+		}
+
+		// the mover may have been removed while it was ticking
+		UGridMovementComponent *Mover = ActiveMovers[Idx];
+		if (IsValid(Mover))
+		{
+			if (!Mover->CanSleep())
+			{
+				Idx++;
+				continue;
+			}
+			Mover->Sleep();
+		}
+		ActiveMovers.RemoveAtSwap(Idx, 1, false);
+		if (Idx < ActiveMovers.Num() && ActiveMovers[Idx])
+		{
+			ActiveMovers[Idx]->ActiveMoverIndex = Idx;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_NavGrid_ActiveMovers, ActiveMovers.Num());
+	if (ActiveMovers.Num() == 0)
+	{
+		TickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UGridMovementSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	Super::Deinitialize();
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GridPathBuilder.h"
+#include "NavGridPrivatePCH.h"
+
+int32 FGridPathBuilder::AddPoint(const FVector &Location, ESplinePointType::Type Type)
+{
+	PointTypes.Add(Type);
+	return Points.Add(Location);
+}
+
+void FGridPathBuilder::AddSegment(const FPathSegment &Segment, int32 StartPoint, int32 EndPoint)
+{
+	Segments.Add(Segment);
+	SegmentPoints.Add(TPair<int32, int32>(StartPoint, EndPoint));
+}
+
+void FGridPathBuilder::Build(USplineComponent &OutSpline, TArray<FPathSegment> &OutSegments) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FGridPathBuilder_Build);
+
+	OutSpline.ClearSplinePoints(false);
+	for (int32 Idx = 0; Idx < Points.Num(); Idx++)
+	{
+		OutSpline.AddSplinePoint(Points[Idx], ESplineCoordinateSpace::Local, false);
+		OutSpline.SetSplinePointType(Idx, PointTypes[Idx], false);
+	}
+	OutSpline.UpdateSpline();
+
+	OutSegments = Segments;
+	for (int32 Idx = 0; Idx < OutSegments.Num(); Idx++)
+	{
+		OutSegments[Idx].Start = OutSpline.GetDistanceAlongSplineAtSplinePoint(SegmentPoints[Idx].Key);
+		OutSegments[Idx].End = OutSpline.GetDistanceAlongSplineAtSplinePoint(SegmentPoints[Idx].Value);
+	}
+}
+
+void FGridPathBuilder::Reset()
+{
+	Points.Reset();
+	PointTypes.Reset();
+	Segments.Reset();
+	SegmentPoints.Reset();
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GridPathSamples.h"
+#include "NavGridPrivatePCH.h"
+#include "Components/SplineComponent.h"
+
+void FGridPathSamples::Build(const USplineComponent &Spline, float SampleSpacing)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FGridPathSamples_Build);
+
+	Reset();
+	if (Spline.GetNumberOfSplinePoints() == 0)
+	{
+		return;
+	}
+
+	Length = Spline.GetSplineLength();
+	Spacing = FMath::Max(SampleSpacing, 1.0f);
+	// the last sample is always at the end of the spline, even if it is closer than Spacing to the one before
+	const int32 NumSamples = FMath::CeilToInt(Length / Spacing) + 1;
+	Locations.Reserve(NumSamples);
+	Rotations.Reserve(NumSamples);
+	for (int32 Idx = 0; Idx < NumSamples; Idx++)
+	{
+		const float Distance = FMath::Min(Idx * Spacing, Length);
+		Locations.Add(Spline.GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local));
+		Rotations.Add(Spline.GetQuaternionAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::Local));
+	}
+}
+
+void FGridPathSamples::Reset()
+{
+	Locations.Reset();
+	Rotations.Reset();
+	Length = 0;
+}
+
+void FGridPathSamples::GetSampleAlpha(float Distance, int32 &OutIndex, float &OutAlpha) const
+{
+	Distance = FMath::Clamp(Distance, 0.0f, Length);
+	OutIndex = FMath::Min(FMath::FloorToInt(Distance / Spacing), Locations.Num() - 1);
+	if (OutIndex == Locations.Num() - 1)
+	{
+		OutAlpha = 0;
+		return;
+	}
+	// the last interval may be shorter than Spacing
+	const float IntervalStart = OutIndex * Spacing;
+	const float IntervalLength = FMath::Min(IntervalStart + Spacing, Length) - IntervalStart;
+	OutAlpha = IntervalLength > 0 ? (Distance - IntervalStart) / IntervalLength : 0;
+}
+
+FVector FGridPathSamples::GetLocation(float Distance) const
+{
+	if (IsEmpty())
+	{
+		return FVector::ZeroVector;
+	}
+	int32 Index;
+	float Alpha;
+	GetSampleAlpha(Distance, Index, Alpha);
+	return Alpha > 0 ? FMath::Lerp(Locations[Index], Locations[Index + 1], Alpha) : Locations[Index];
+}
+
+float FGridPathSamples::FindClosestDistance(const FVector &Location, int32 &InOutSample) const
+{
+	if (IsEmpty())
+	{
+		return 0;
+	}
+	InOutSample = FMath::Clamp(InOutSample, 0, Locations.Num() - 1);
+	while (InOutSample + 1 < Locations.Num() &&
+		FVector::DistSquared(Locations[InOutSample + 1], Location) <= FVector::DistSquared(Locations[InOutSample], Location))
+	{
+		InOutSample++;
+	}
+	return FMath::Min(InOutSample * Spacing, Length);
+}
+
+FTransform FGridPathSamples::GetTransform(float Distance) const
+{
+	if (IsEmpty())
+	{
+		return FTransform::Identity;
+	}
+	int32 Index;
+	float Alpha;
+	GetSampleAlpha(Distance, Index, Alpha);
+	if (Alpha > 0)
+	{
+		return FTransform(FQuat::Slerp(Rotations[Index], Rotations[Index + 1], Alpha), FMath::Lerp(Locations[Index], Locations[Index + 1], Alpha));
+	}
+	return FTransform(Rotations[Index], Locations[Index]);
+}
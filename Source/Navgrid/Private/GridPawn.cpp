@@ -10,7 +10,7 @@
 AGridPawn::AGridPawn()
 	: Super()
 {
- 	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	// Movement is ticked by UGridMovementSubsystem, BeginPlay() turns ticking off again unless a blueprint implements Event Tick
 	PrimaryActorTick.bCanEverTick = true;
 
 	SceneRoot = CreateDefaultSubobject<USceneComponent>("Root");
@@ -63,6 +63,11 @@ void AGridPawn::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (!GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AGridPawn, ReceiveTick)))
+	{
+		SetActorTickEnabled(false);
+	}
+
 	ATurnManager *TurnManager =TurnComponent->GetTurnManager();
 	if (IsValid(TurnManager))
 	{
@@ -76,6 +81,13 @@ void AGridPawn::BeginPlay()
 
 	SetGenericTeamId(TeamId);
 
+	// the simulation may have started before we began play
+	ANavGridGameMode *GameMode = GetWorld()->GetAuthGameMode<ANavGridGameMode>();
+	if (GameMode && GameMode->IsSimulating())
+	{
+		GameMode->ApplySimulationSettings(*this);
+	}
+
 #if WITH_EDITORONLY_DATA
 	GEditor->GetTimerManager()->ClearTimer(PreviewTimerHandle);
 #endif //WITH_EDITORONLY_DATA
@@ -235,13 +247,32 @@ bool AGridPawn::CanBeSelected()
 }
 
 bool AGridPawn::CanMoveTo(const UNavTileComponent & Tile)
+{
+	// a provisional range could reject tiles that are reachable once the rest of the virtual tiles are placed
+	return IsTileInMoveRange(Tile, true);
+}
+
+bool AGridPawn::CanMoveToProvisionally(const UNavTileComponent & Tile)
+{
+	return IsTileInMoveRange(Tile, false);
+}
+
+bool AGridPawn::IsTileInMoveRange(const UNavTileComponent & Tile, bool bCompleteVirtualTiles)
 {
 	if (MovementComponent->GetTile() != &Tile &&
-		Tile.LegalPositionAtEndOfTurn(MovementComponent->AvailableMovementModes))
+		Tile.LegalPositionAtEndOfTurn(MovementComponent->AvailableMovementModeFlags))
 	{
+		ANavGrid *Grid = MovementComponent->GetNavGrid();
 		TArray<UNavTileComponent *> InRange;
-		MovementComponent->GetNavGrid()->GetTilesInRange(this, InRange);
-		if (Tile.Distance <= MovementComponent->MovementRange)
+		if (bCompleteVirtualTiles)
+		{
+			Grid->GetCompleteTilesInRange(this, InRange);
+		}
+		else
+		{
+			Grid->GetTilesInRange(this, InRange);
+		}
+		if (Grid->GetDistance(Tile) <= MovementComponent->MovementRange)
 		{
 			return true;
 		}
@@ -315,10 +346,8 @@ void AGridPawn::UpdatePreviewTiles()
 	}
 
 	TArray<UNavTileComponent *> Tiles;
-	PreviewGrid->GetTilesInRange(this, Tiles);
-	for (UNavTileComponent *Tile : Tiles)
-	{
-		Tile->SetHighlight("Movable");
-	}
+	// the grid does not tick in the editor, so place every virtual tile and set the highlights right away
+	PreviewGrid->GetCompleteTilesInRange(this, Tiles);
+	PreviewGrid->SetHighlightedTiles("Movable", Tiles);
 }
 #endif //WITH_EDITORONLY_DATA
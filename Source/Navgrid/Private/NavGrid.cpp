@@ -2,20 +2,101 @@
 
 #include "NavGrid.h"
 #include "NavGridPrivatePCH.h"
+#include "NavGridBakedTiles.h"
+#include "NavGridSubsystem.h"
 #include "AssetRegistryModule.h"
+#include "Async/Async.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#if WITH_EDITOR
+#include "Engine/LevelBounds.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Materials/MaterialExpressionAppendVector.h"
+#include "Materials/MaterialExpressionPerInstanceCustomData.h"
+#endif
 
 #include <limits>
 
 DEFINE_LOG_CATEGORY(NavGrid);
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Expanded tiles"), STAT_NavGrid_ExpandedTiles, STATGROUP_NavGrid);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Range cache hits"), STAT_NavGrid_RangeCacheHits, STATGROUP_NavGrid);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Range cache misses"), STAT_NavGrid_RangeCacheMisses, STATGROUP_NavGrid);
+DECLARE_MEMORY_STAT(TEXT("Range cache memory"), STAT_NavGrid_RangeCacheMemory, STATGROUP_NavGrid);
+DECLARE_CYCLE_STAT(TEXT("Generate virtual tiles"), STAT_NavGrid_GenerateVirtualTiles, STATGROUP_NavGrid);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Virtual tile traces"), STAT_NavGrid_VirtualTileTraces, STATGROUP_NavGrid);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending virtual tile traces"), STAT_NavGrid_PendingVirtualTileTraces, STATGROUP_NavGrid);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Virtual tiles"), STAT_NavGrid_VirtualTiles, STATGROUP_NavGrid);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled virtual tiles"), STAT_NavGrid_PooledVirtualTiles, STATGROUP_NavGrid);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Recycled virtual tiles"), STAT_NavGrid_RecycledVirtualTiles, STATGROUP_NavGrid);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evicted virtual tiles"), STAT_NavGrid_EvictedVirtualTiles, STATGROUP_NavGrid);
+DECLARE_CYCLE_STAT(TEXT("Update highlights"), STAT_NavGrid_UpdateHighlights, STATGROUP_NavGrid);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Highlight instances"), STAT_NavGrid_HighlightInstances, STATGROUP_NavGrid);
+
+namespace
+{
+	/* Custom data of the shared highlight mesh: RGBA colour and pattern */
+	const int32 HighlightCustomDataFloats = 5;
+
+	/* Part of ANavGrid::MaxVirtualTiles recycled at once when a new virtual tile does not fit, so eviction does not sort the tiles for every trace */
+	const int32 VirtualTileEvictionDivisor = 16;
+
+	/* Contribution of a tile in ANavGrid::PawnTiles to the occupancy hash */
+	uint32 HashOccupiedTile(int32 TileIndex)
+	{
+		return TileIndex != INDEX_NONE ? FCrc::MemCrc32(&TileIndex, sizeof(TileIndex)) : 0;
+	}
+
+	/* Material for the shared highlight mesh when ANavGrid::HighlightMaterial is not set. No such asset ships with the plugin, so it is built here */
+	UMaterialInterface *GetDefaultHighlightMaterial()
+	{
+#if WITH_EDITOR
+		static UMaterial *Default = nullptr;
+		if (!Default)
+		{
+			Default = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+			Default->AddToRoot();
+			Default->SetShadingModel(MSM_Unlit);
+			Default->BlendMode = BLEND_Translucent;
+			Default->bUsedWithInstancedStaticMeshes = true;
+
+			// colour and opacity come from custom data 0-3, the pattern in custom data 4 is ignored
+			UMaterialExpressionPerInstanceCustomData *Channels[4];
+			for (int32 Idx = 0; Idx < 4; Idx++)
+			{
+				Channels[Idx] = NewObject<UMaterialExpressionPerInstanceCustomData>(Default);
+				Channels[Idx]->DataIndex = Idx;
+				Default->Expressions.Add(Channels[Idx]);
+			}
+			UMaterialExpressionAppendVector *RG = NewObject<UMaterialExpressionAppendVector>(Default);
+			RG->A.Expression = Channels[0];
+			RG->B.Expression = Channels[1];
+			Default->Expressions.Add(RG);
+			UMaterialExpressionAppendVector *RGB = NewObject<UMaterialExpressionAppendVector>(Default);
+			RGB->A.Expression = RG;
+			RGB->B.Expression = Channels[2];
+			Default->Expressions.Add(RGB);
+
+			Default->EmissiveColor.Expression = RGB;
+			Default->Opacity.Expression = Channels[3];
+			Default->PostEditChange();
+		}
+		return Default;
+#else
+		return nullptr;
+#endif
+	}
+}
+
 TEnumAsByte<ECollisionChannel> ANavGrid::ECC_NavGridWalkable = ECollisionChannel::ECC_GameTraceChannel1;
 FName ANavGrid::DisableVirtualTilesTag = "NavGrid:DisableVirtualTiles";
 
 // Sets default values
 ANavGrid::ANavGrid()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// Tick() places virtual tiles and applies highlight changes, it is only enabled while there is work left
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	TileClass = UNavTileComponent::StaticClass();
 
@@ -37,34 +118,305 @@ ANavGrid::ANavGrid()
 		UE_LOG(NavGrid, Error, TEXT("Error loading %s"), HCRef);
 	}
 
-	AddHighlightType("Movable", TEXT("Material'/NavGrid/Materials/Movable_Mat.Movable_Mat'"));
-	AddHighlightType("Dangerous", TEXT("Material'/NavGrid/Materials/Dangerous_Mat.Dangerous_Mat'"));
-	AddHighlightType("Special", TEXT("Material'/NavGrid/Materials/Special_Mat.Special_Mat'"));
+	FNavGridHighlightStyle MovableStyle;
+	MovableStyle.Color = FLinearColor(0, 0.3f, 1, 0.5f);
+	FNavGridHighlightStyle DangerousStyle;
+	DangerousStyle.Color = FLinearColor(1, 0, 0, 0.5f);
+	DangerousStyle.Pattern = 1;
+	FNavGridHighlightStyle SpecialStyle;
+	SpecialStyle.Color = FLinearColor(1, 0.8f, 0, 0.5f);
+	SpecialStyle.Pattern = 2;
+	AddHighlightType("Movable", TEXT("Material'/NavGrid/Materials/Movable_Mat.Movable_Mat'"), MovableStyle);
+	AddHighlightType("Dangerous", TEXT("Material'/NavGrid/Materials/Dangerous_Mat.Dangerous_Mat'"), DangerousStyle);
+	AddHighlightType("Special", TEXT("Material'/NavGrid/Materials/Special_Mat.Special_Mat'"), SpecialStyle);
 
 	CurrentPawn = NULL;
 	CurrentTile = NULL;
 }
 
+void ANavGrid::BeginPlay()
+{
+	Super::BeginPlay();
+	if (bSingleHighlightMesh && !GetHighlightMaterial())
+	{
+		UE_LOG(NavGrid, Warning, TEXT("%s: bSingleHighlightMesh needs a HighlightMaterial in cooked builds, drawing one mesh per highlight type instead"), *GetName());
+	}
+	PlaceBakedTiles();
+	BakeNeighbourGraph();
+}
+
+void ANavGrid::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (VirtualTileJob.bActive)
+	{
+		RunVirtualTileJob();
+	}
+	if (!VirtualTileJob.bActive)
+	{
+		FinishVirtualTileJob();
+	}
+
+	FlushTileHighlights();
+	SetActorTickEnabled(VirtualTileJob.bActive);
+}
+
+void ANavGrid::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+
+	// tiles normally register themselves, but pick up any that were registered before this grid existed
+	UNavGridSubsystem *Subsystem = GetWorld() ? GetWorld()->GetSubsystem<UNavGridSubsystem>() : nullptr;
+	if (Subsystem)
+	{
+		Subsystem->AddGrid(*this);
+	}
+}
+
 void ANavGrid::SetTileHighlight(UNavTileComponent & Tile, FName Type)
 {
-	Tile.SetHighlight(Type);
+	if (GetTileIndex(Tile) != INDEX_NONE)
+	{
+		FTileHighlightSet &Set = HighlightSets.FindOrAdd(Type);
+		BeginHighlightChanges(Set);
+		Set.Pending.Add(&Tile);
+	}
+}
+
+void ANavGrid::SetHighlightedTiles(FName Type, const TArray<UNavTileComponent *> &HighlightedTiles)
+{
+	FTileHighlightSet &Set = HighlightSets.FindOrAdd(Type);
+	Set.Pending.Reset();
+	for (UNavTileComponent *Tile : HighlightedTiles)
+	{
+		if (Tile && GetTileIndex(*Tile) != INDEX_NONE)
+		{
+			Set.Pending.Add(Tile);
+		}
+	}
+	ApplyTileHighlights(Type, Set);
 }
 
 void ANavGrid::ClearTileHighlights()
 {
-	for (auto &H : TileHighlights)
+	for (auto &Pair : HighlightSets)
+	{
+		FTileHighlightSet &Set = Pair.Value;
+		if (Set.Instances.Num() || Set.Pending.Num())
+		{
+			Set.Pending.Reset();
+			Set.bDirty = true;
+			SetActorTickEnabled(true);
+		}
+	}
+}
+
+void ANavGrid::FlushTileHighlights()
+{
+	for (auto &Pair : HighlightSets)
+	{
+		if (Pair.Value.bDirty)
+		{
+			ApplyTileHighlights(Pair.Key, Pair.Value);
+		}
+	}
+}
+
+void ANavGrid::BeginHighlightChanges(FTileHighlightSet &Set)
+{
+	if (!Set.bDirty)
+	{
+		Set.Pending.Reset();
+		for (const auto &Pair : Set.Instances)
+		{
+			Set.Pending.Add(Pair.Key);
+		}
+		Set.bDirty = true;
+		SetActorTickEnabled(true);
+	}
+}
+
+void ANavGrid::ApplyTileHighlights(FName Type, FTileHighlightSet &Set)
+{
+	SCOPE_CYCLE_COUNTER(STAT_NavGrid_UpdateHighlights);
+
+	Set.bDirty = false;
+	UInstancedStaticMeshComponent *Comp = GetHighlightComponent(Type);
+	if (!Comp)
+	{
+		Set.Pending.Reset();
+		return;
+	}
+	const bool bSharedMesh = UsesSingleHighlightMesh();
+	FHighlightInstances &Buffer = HighlightInstances.FindOrAdd(GetHighlightMeshKey(Type));
+
+	// instances of tiles that lost the highlight are reused for tiles that gained it
+	TArray<int32> &FreeInstances = Buffer.FreeInstances;
+	bool bChanged = FreeInstances.Num() > 0;
+	for (auto Itr = Set.Instances.CreateIterator(); Itr; ++Itr)
+	{
+		if (!Set.Pending.Contains(Itr.Key()))
+		{
+			FreeInstances.Add(Itr.Value());
+			Buffer.Owners[Itr.Value()].Value = nullptr;
+			Itr.RemoveCurrent();
+			bChanged = true;
+		}
+	}
+
+	const FVector MeshSize = Comp->GetStaticMesh()->GetBoundingBox().GetSize();
+	for (const UNavTileComponent *Tile : Set.Pending)
+	{
+		if (Set.Instances.Contains(Tile))
+		{
+			continue;
+		}
+		FTransform Transform = Tile->GetHighlightTransform(MeshSize);
+		int32 Instance;
+		if (FreeInstances.Num())
+		{
+			Instance = FreeInstances.Pop(false);
+			Comp->UpdateInstanceTransform(Instance, Transform, true, false);
+			Buffer.Owners[Instance] = TPair<FName, const UNavTileComponent *>(Type, Tile);
+		}
+		else
+		{
+			Instance = Comp->AddInstanceWorldSpace(Transform);
+			Buffer.Owners.Add(TPair<FName, const UNavTileComponent *>(Type, Tile));
+		}
+		if (bSharedMesh)
+		{
+			SetHighlightCustomData(*Comp, Instance, Type);
+		}
+		Set.Instances.Add(Tile, Instance);
+		bChanged = true;
+	}
+	Set.Pending.Reset();
+
+	// fill the remaining gaps with the last instances, removing from the end does not shift any indices
+	FreeInstances.Sort(TGreater<int32>());
+	for (int32 Gap : FreeInstances)
+	{
+		int32 Last = Buffer.Owners.Num() - 1;
+		if (Gap != Last)
+		{
+			FTransform Transform;
+			Comp->GetInstanceTransform(Last, Transform, true);
+			Comp->UpdateInstanceTransform(Gap, Transform, true, false);
+			// the moved instance may belong to another highlight type when the mesh is shared
+			const TPair<FName, const UNavTileComponent *> Moved = Buffer.Owners[Last];
+			if (bSharedMesh)
+			{
+				SetHighlightCustomData(*Comp, Gap, Moved.Key);
+			}
+			Buffer.Owners[Gap] = Moved;
+			HighlightSets[Moved.Key].Instances[Moved.Value] = Gap;
+		}
+		Comp->RemoveInstance(Last);
+		Buffer.Owners.Pop(false);
+	}
+	FreeInstances.Reset();
+
+	if (bChanged)
+	{
+		Comp->MarkRenderStateDirty();
+	}
+
+	int32 NumInstances = 0;
+	for (const auto &Pair : HighlightInstances)
+	{
+		NumInstances += Pair.Value.Owners.Num();
+	}
+	SET_DWORD_STAT(STAT_NavGrid_HighlightInstances, NumInstances);
+}
+
+void ANavGrid::RemoveTileHighlights(const UNavTileComponent &Tile)
+{
+	for (auto &Pair : HighlightSets)
+	{
+		FTileHighlightSet &Set = Pair.Value;
+		if (Set.Instances.Contains(&Tile))
+		{
+			BeginHighlightChanges(Set);
+			int32 Instance = Set.Instances.FindAndRemoveChecked(&Tile);
+			// the instances may belong to the other kind of mesh if HighlightMaterial changed since they were added
+			FHighlightInstances *Buffer = HighlightInstances.Find(GetHighlightMeshKey(Pair.Key));
+			if (Buffer && Buffer->Owners.IsValidIndex(Instance) && Buffer->Owners[Instance].Value == &Tile)
+			{
+				Buffer->Owners[Instance].Value = nullptr;
+				Buffer->FreeInstances.Add(Instance);
+			}
+		}
+		// a change that is already pending must not highlight Tile either
+		Set.Pending.Remove(&Tile);
+	}
+}
+
+UMaterialInterface *ANavGrid::GetHighlightMaterial() const
+{
+	return HighlightMaterial ? HighlightMaterial : GetDefaultHighlightMaterial();
+}
+
+FName ANavGrid::GetHighlightMeshKey(FName Type) const
+{
+	return UsesSingleHighlightMesh() ? NAME_None : Type;
+}
+
+void ANavGrid::SetHighlightCustomData(UInstancedStaticMeshComponent &Comp, int32 Instance, FName Type) const
+{
+	const FNavGridHighlightStyle Style = HighlightStyles.FindRef(Type);
+	TArray<float> CustomData({ Style.Color.R, Style.Color.G, Style.Color.B, Style.Color.A, (float)Style.Pattern });
+	Comp.SetCustomData(Instance, CustomData, false);
+}
+
+void ANavGrid::UpdateTileHighlights(const UNavTileComponent &Tile)
+{
+	for (auto &Pair : HighlightSets)
 	{
-		H.Value->ClearInstances();
+		const int32 *Instance = Pair.Value.Instances.Find(&Tile);
+		UInstancedStaticMeshComponent *Comp = TileHighlights.FindRef(GetHighlightMeshKey(Pair.Key));
+		if (Instance && Comp)
+		{
+			const FVector MeshSize = Comp->GetStaticMesh()->GetBoundingBox().GetSize();
+			Comp->UpdateInstanceTransform(*Instance, Tile.GetHighlightTransform(MeshSize), true, true);
+		}
 	}
 }
 
-void ANavGrid::AddHighlightType(const FName &Type, const TCHAR *FileName)
+void ANavGrid::AddHighlightType(const FName &Type, const TCHAR *FileName, const FNavGridHighlightStyle &Style)
 {
 	TileHighLightPaths.Add(Type, FileName);
+	// do not overwrite styles set in the editor
+	if (!HighlightStyles.Contains(Type))
+	{
+		HighlightStyles.Add(Type, Style);
+	}
 }
 
 UInstancedStaticMeshComponent * ANavGrid::GetHighlightComponent(FName Type)
 {
+	if (UsesSingleHighlightMesh())
+	{
+		/* every highlight type shares one mesh, the material picks the colour from the custom data */
+		UInstancedStaticMeshComponent *Comp = TileHighlights.FindRef(NAME_None);
+		if (!Comp && TileHighLightPaths.Contains(Type))
+		{
+			UStaticMesh *Mesh = LoadObject<UStaticMesh>(this, TEXT("StaticMesh'/NavGrid/SMesh/NavGrid_TileHighlight.NavGrid_TileHighlight'"));
+			check(Mesh);
+			Comp = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+			Comp->SetupAttachment(GetRootComponent());
+			Comp->SetStaticMesh(Mesh);
+			Comp->SetMaterial(0, GetHighlightMaterial());
+			Comp->NumCustomDataFloats = HighlightCustomDataFloats;
+			Comp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Comp->RegisterComponent();
+			Comp->bOnlyOwnerSee = true;
+			TileHighlights.Add(NAME_None, Comp);
+		}
+		return TileHighLightPaths.Contains(Type) ? Comp : nullptr;
+	}
+
 	/* build the instanced mesh component if we have not already done so */
 	if (!TileHighlights.Contains(Type) && TileHighLightPaths.Contains(Type))
 	{
@@ -113,7 +465,95 @@ ANavGrid * ANavGrid::GetNavGrid(UWorld *World)
 
 UNavTileComponent *ANavGrid::GetTile(const FVector &WorldLocation, bool FindFloor/*= true*/, float UpwardTraceLength/* = 100*/, float DownwardTraceLength/* = 100*/)
 {
-	return LineTraceTile(WorldLocation, FindFloor, UpwardTraceLength, DownwardTraceLength);
+	UNavTileComponent *Tile = FindIndexedTile(WorldLocation, FindFloor, UpwardTraceLength, DownwardTraceLength);
+	if (!Tile && bTraceForUnindexedTiles)
+	{
+		Tile = LineTraceTile(WorldLocation, FindFloor, UpwardTraceLength, DownwardTraceLength);
+	}
+	return Tile;
+}
+
+UNavTileComponent *ANavGrid::FindIndexedTile(const FVector &WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength)
+{
+	return GetTileByIndex(FindTileIndex(WorldLocation, FindFloor, UpwardTraceLength, DownwardTraceLength));
+}
+
+int32 ANavGrid::FindTileIndex(const FVector &WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_FindTileIndex);
+
+	if (SpatialCellSize != TileSize)
+	{
+		RebuildSpatialIndex();
+	}
+
+	int32 Result = INDEX_NONE;
+	if (FindFloor)
+	{
+		// a downward trace hits the tile with the highest top surface along the trace
+		const float TraceTop = WorldLocation.Z + UpwardTraceLength;
+		const float TraceBottom = WorldLocation.Z - DownwardTraceLength;
+		float BestHeight = -std::numeric_limits<float>::infinity();
+		const auto *Cell = SpatialIndex.Find(GetSpatialCell(WorldLocation.X, WorldLocation.Y));
+		if (Cell)
+		{
+			for (int32 Index : *Cell)
+			{
+				const FNavGridTileRecord &Candidate = TileRecords[Index];
+				FVector LocalOffset = Candidate.Rotation.UnrotateVector(WorldLocation - Candidate.Location);
+				if (FMath::Abs(LocalOffset.X) > Candidate.Extent.X || FMath::Abs(LocalOffset.Y) > Candidate.Extent.Y)
+				{
+					continue;
+				}
+				const FBox &Box = Candidate.Bounds;
+				if (Box.Max.Z >= TraceBottom && Box.Min.Z <= TraceTop)
+				{
+					float Height = FMath::Min(Box.Max.Z, TraceTop);
+					if (Height > BestHeight)
+					{
+						BestHeight = Height;
+						Result = Index;
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		// the horizontal traces reach 200 units in every direction, pick the closest tile at our height
+		const float Reach = 200;
+		FIntPoint MinCell = GetSpatialCell(WorldLocation.X - Reach, WorldLocation.Y - Reach);
+		FIntPoint MaxCell = GetSpatialCell(WorldLocation.X + Reach, WorldLocation.Y + Reach);
+		float BestDistance = std::numeric_limits<float>::infinity();
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				const auto *Cell = SpatialIndex.Find(FIntPoint(X, Y));
+				if (!Cell)
+				{
+					continue;
+				}
+				for (int32 Index : *Cell)
+				{
+					const FNavGridTileRecord &Candidate = TileRecords[Index];
+					const FBox &Box = Candidate.Bounds;
+					if (WorldLocation.Z < Box.Min.Z || WorldLocation.Z > Box.Max.Z || Box.ComputeSquaredDistanceToPoint(WorldLocation) > FMath::Square(Reach))
+					{
+						continue;
+					}
+					float Distance = FVector::Dist(Candidate.Location, WorldLocation);
+					if (Distance < BestDistance)
+					{
+						BestDistance = Distance;
+						Result = Index;
+					}
+				}
+			}
+		}
+	}
+
+	return Result;
 }
 
 UNavTileComponent * ANavGrid::LineTraceTile(const FVector & WorldLocation, bool FindFloor, float UpwardTraceLength, float DownwardTraceLength)
@@ -194,182 +634,1528 @@ void ANavGrid::EndTileCursorOver(const UNavTileComponent *Tile)
 
 void ANavGrid::CalculateTilesInRange(AGridPawn *Pawn)
 {
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_CalculateTilesInRange);
-
 	ClearTiles();
-	if (EnableVirtualTiles)
+	RangeCache.SetBudget((SIZE_T)RangeCacheBudgetKB * 1024);
+
+	FNavGridRangeCacheKey Key = GetRangeCacheKey(Pawn);
+	uint32 OccupancyHash = GetOccupancyHash(Pawn);
+	TArray<int32> ReachedTiles;
+	const bool bRestored = Key.StartIndex != INDEX_NONE && RangeCache.Restore(Key, OccupancyHash, Tiles.Num(), RangeContext, ReachedTiles);
+	if (bRestored)
 	{
-		GenerateVirtualTiles(Pawn);
+		TilesInRange = MoveTemp(ReachedTiles);
+		NumExpandedTiles = 0;
+		NumRangeCacheHits++;
+		INC_DWORD_STAT(STAT_NavGrid_RangeCacheHits);
 	}
-	UNavTileComponent *Current = Pawn->GetTile();
-	/* if we're not on the grid, the number of tiles in range is zero */
-	if (!Current)
+	else
 	{
-		return;
-	}
+		CalculateTilesInRange(Pawn, RangeContext, TilesInRange);
+		NumExpandedTiles = RangeContext.NumExpanded;
+		NumRangeCacheMisses++;
+		INC_DWORD_STAT(STAT_NavGrid_RangeCacheMisses);
 
-	Current->Distance = 0;
-	TArray<UNavTileComponent *> NeighbouringTiles;
-	Current->GetUnobstructedNeighbours(*Pawn->MovementCollisionCapsule, NeighbouringTiles);
-	TArray<UNavTileComponent *> TentativeSet(NeighbouringTiles);
+		// virtual tiles may have been placed under the pawns
+		Key = GetRangeCacheKey(Pawn);
+		OccupancyHash = GetOccupancyHash(Pawn);
+	}
 
-	while (Current)
+	CurrentRangeBounds = FBox(ForceInit);
+	if (Key.StartIndex != INDEX_NONE)
 	{
-		Current->GetUnobstructedNeighbours(*Pawn->MovementCollisionCapsule, NeighbouringTiles);
-		for (UNavTileComponent *N : NeighbouringTiles)
-		{
-			if (!N->Traversable(Pawn->MovementComponent->AvailableMovementModes))
-			{
-				continue;
-			}
-
-			if (!N->Visited)
-			{
-				float TentativeDistance = N->Cost + Current->Distance;
-				if (TentativeDistance <= N->Distance)
-				{
+		CurrentRangeBounds += TileRecords[Key.StartIndex].Bounds;
+	}
+	for (int32 Index : TilesInRange)
+	{
+		CurrentRangeBounds += TileRecords[Index].Bounds;
+	}
 
-					//	Prioritize straight paths by using the world distance as a tiebreaker
-					//	when TentativeDistance is equal N->Dinstance
-					float OldDistance = std::numeric_limits<float>::infinity();
-					float NewDistance = 0;
-					if (TentativeDistance == N->Distance)
-					{
-						NewDistance = (Current->GetComponentLocation() - N->GetComponentLocation()).Size();
-						if (N->Backpointer)
-						{
-							OldDistance = (N->Backpointer->GetComponentLocation() - N->GetComponentLocation()).Size();
-						}
-					}
+	// tiles that have not been placed yet may make more of the grid reachable
+	bTilesInRangeProvisional = !bRestored && IsGeneratingVirtualTiles(Pawn);
+	if (!bRestored && Key.StartIndex != INDEX_NONE && !bTilesInRangeProvisional)
+	{
+		RangeCache.Store(Key, OccupancyHash, RangeContext, TilesInRange, CurrentRangeBounds);
+	}
+	SET_MEMORY_STAT(STAT_NavGrid_RangeCacheMemory, RangeCache.GetAllocatedSize());
 
-					if (NewDistance < OldDistance) // Always true if TentativeDistance < N->Distance
-					{
-						N->Distance = TentativeDistance;
-						N->Backpointer = Current;
+	CurrentPawn = Pawn;
+	CurrentTile = Pawn->GetTile();
+	CurrentRangeKey = Key;
+	CurrentOccupancyHash = OccupancyHash;
+}
 
-						if (TentativeDistance <= Pawn->MovementComponent->MovementRange)
-						{
-							TentativeSet.AddUnique(N);
-						}
-					}
-				}
-			}
-		}
-		Current->Visited = true;
-		TentativeSet.Remove(Current);
-		if (Current != Pawn->GetTile()) { TilesInRange.Add(Current); } // dont include the starting tile
-		if (TentativeSet.Num())
-		{
-			Current = TentativeSet[0];
-		}
-		else
-		{
-			Current = NULL;
-		}
-	}
+void ANavGrid::InvalidateRangeCache()
+{
+	RangeCache.Empty();
+	Snapshot.Reset();
+	CurrentPawn = nullptr;
+	GeneratedRadius = INDEX_NONE;
+	SET_MEMORY_STAT(STAT_NavGrid_RangeCacheMemory, 0);
 }
 
-void ANavGrid::GetTilesInRange(AGridPawn *Pawn, TArray<UNavTileComponent*>& OutTiles)
+void ANavGrid::InvalidateRangeCacheNear(const FBox &Bounds)
 {
-	if (Pawn != CurrentPawn || Pawn->GetTile() != CurrentTile)
+	if (!Bounds.IsValid)
 	{
-		CalculateTilesInRange(Pawn);
-		CurrentPawn = Pawn;
-		CurrentTile = Pawn->GetTile();
+		return;
 	}
-	OutTiles = TilesInRange;
-}
 
-void ANavGrid::ClearTiles()
-{
-	TilesInRange.Empty();
-	TArray<UNavTileComponent *> AllTiles;
-	GetEveryTile(AllTiles, GetWorld());
-	for (auto *T : AllTiles)
+	// a range search may also have been stopped by a tile next to the ones it reached, see InvalidateEdgesNear()
+	const FBox Reach = Bounds.ExpandBy(TileSize);
+	RangeCache.Invalidate(Reach);
+	Snapshot.Reset();
+	InvalidateGeneratedArea(Reach);
+	if (CurrentRangeBounds.Intersect(Reach))
 	{
-		T->Reset();
+		CurrentPawn = nullptr;
 	}
+	SET_MEMORY_STAT(STAT_NavGrid_RangeCacheMemory, RangeCache.GetAllocatedSize());
+}
 
-	ClearTileHighlights();
-	NumPersistentTiles = AllTiles.Num() - VirtualTiles.Num();
+FNavGridRangeCacheKey ANavGrid::GetRangeCacheKey(AGridPawn *Pawn)
+{
+	FNavGridRangeCacheKey Key;
+	UNavTileComponent *Tile = Pawn->GetTile();
+	Key.PawnId = Pawn->GetUniqueID();
+	Key.StartIndex = Tile ? GetTileIndex(*Tile) : INDEX_NONE;
+	Key.MovementRange = Pawn->MovementComponent->MovementRange;
+	Key.MovementModeMask = Pawn->MovementComponent->AvailableMovementModeFlags.Mask;
+	const UCapsuleComponent &Capsule = *Pawn->MovementCollisionCapsule;
+	Key.CapsuleRadius = Capsule.GetScaledCapsuleRadius();
+	Key.CapsuleHalfHeight = Capsule.GetScaledCapsuleHalfHeight();
+	Key.CapsuleOffset = Capsule.GetRelativeLocation();
+	return Key;
 }
 
-bool ANavGrid::TraceTileLocation(const FVector & TraceStart, const FVector & TraceEnd, FVector & OutTilePos)
+uint32 ANavGrid::GetOccupancyHash(const AGridPawn *IgnoredPawn)
 {
-	FCollisionQueryParams CQP;
-	CQP.bFindInitialOverlaps = true;
-	CQP.TraceTag = "NavGridTilePlacement";
-	FHitResult HitResult;
+	UpdateUnplacedPawnTiles();
 
-	GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECollisionChannel::ECC_Pawn, CQP);
-	bool bHasDisableTileTag = false;
-	if (IsValid(HitResult.GetActor()))
-	{
-		bHasDisableTileTag = HitResult.GetActor()->ActorHasTag(DisableVirtualTilesTag);
-	}
+	// a sum of hashes does not depend on the order of the pawns, so the ignored pawn can simply be subtracted
+	const int32 *IgnoredTile = PawnTiles.Find(IgnoredPawn);
+	return IgnoredTile ? TotalOccupancyHash - HashOccupiedTile(*IgnoredTile) : TotalOccupancyHash;
+}
 
-	OutTilePos = HitResult.ImpactPoint;
-	// return true if we hit the 'outside' of something that does not have the disabletile-tag
-	return HitResult.bBlockingHit && !HitResult.bStartPenetrating && !bHasDisableTileTag;
+void ANavGrid::SetPawnTile(const AGridPawn &Pawn, UNavTileComponent *Tile)
+{
+	const int32 Index = Tile && BlocksOtherPawns(Pawn) ? GetTileIndex(*Tile) : INDEX_NONE;
+	int32 &PawnTile = PawnTiles.FindOrAdd(&Pawn, INDEX_NONE);
+	TotalOccupancyHash += HashOccupiedTile(Index) - HashOccupiedTile(PawnTile);
+	PawnTile = Index;
 }
 
-UNavTileComponent * ANavGrid::PlaceTile(const FVector & Location, AActor * TileOwner)
+void ANavGrid::RemovePawn(const AGridPawn &Pawn)
 {
-	if (!TileOwner)
+	int32 PawnTile;
+	if (PawnTiles.RemoveAndCopyValue(&Pawn, PawnTile))
 	{
-		TileOwner = this;
+		TotalOccupancyHash -= HashOccupiedTile(PawnTile);
 	}
-
-	UNavTileComponent *TileComp = NewObject<UNavTileComponent>(TileOwner, TileClass);
-	TileComp->SetupAttachment(TileOwner->GetRootComponent());
-	TileComp->SetWorldTransform(FTransform::Identity);
-	TileComp->SetWorldLocation(Location);
-	TileComp->SetBoxExtent(FVector(TileSize / 2, TileSize / 2, 5));
-	TileComp->RegisterComponentWithWorld(TileOwner->GetWorld());
-	TileComp->SetGrid(this);
-
-	return TileComp;
 }
 
-UNavTileComponent * ANavGrid::ConsiderPlaceTile(const FVector &TraceStart, const FVector &TraceEnd, AActor * TileOwner /*= NULL*/)
+void ANavGrid::UpdateUnplacedPawnTiles()
 {
-	if (!TileOwner)
+	if (!bPawnTilesStale)
 	{
-		TileOwner = this;
+		return;
+	}
+	bPawnTilesStale = false;
+
+	TArray<const AGridPawn *> Unplaced;
+	for (const auto &Pair : PawnTiles)
+	{
+		if (Pair.Value == INDEX_NONE && Pair.Key.IsValid())
+		{
+			Unplaced.Add(Pair.Key.Get());
+		}
+	}
+	for (const AGridPawn *Pawn : Unplaced)
+	{
+		if (IsValid(Pawn->MovementComponent))
+		{
+			// the cached tile may have been registered again at the same place, so tell ourselves even if it did not change
+			Pawn->MovementComponent->ConsiderUpdateCurrentTile();
+			SetPawnTile(*Pawn, Pawn->MovementComponent->GetCachedTile());
+		}
+	}
+}
+
+bool ANavGrid::BlocksOtherPawns(const AGridPawn &Pawn)
+{
+	for (UActorComponent *Component : Pawn.GetComponents())
+	{
+		const UPrimitiveComponent *Primitive = Cast<UPrimitiveComponent>(Component);
+		if (Primitive && Primitive->IsQueryCollisionEnabled() && Primitive->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Block)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ANavGrid::CalculateTilesInRange(AGridPawn *Pawn, FNavGridSearchContext &Context, TArray<int32> &OutTileIndices)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_CalculateTilesInRange);
+
+	OutTileIndices.Reset();
+	if (EnableVirtualTiles)
+	{
+		GenerateVirtualTiles(Pawn);
+	}
+	Context.Reset(Tiles.Num());
+
+	UNavTileComponent *Start = Pawn->GetTile();
+	int32 StartIndex = Start ? GetTileIndex(*Start) : INDEX_NONE;
+	/* if we're not on the grid, the number of tiles in range is zero */
+	if (StartIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const float MovementRange = Pawn->MovementComponent->MovementRange;
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(Pawn->MovementComponent->AvailableMovementModeFlags.Mask);
+	const UCapsuleComponent &Capsule = *Pawn->MovementCollisionCapsule;
+	const int32 Profile = GetCapsuleProfile(Capsule);
+	TArray<int32> NeighbouringTiles;
+	BlockOccupiedTiles(Pawn, Context);
+
+	Context.SetDistance(StartIndex, 0, INDEX_NONE);
+	Context.OpenSet.Push(StartIndex, 0);
+	while (!Context.OpenSet.IsEmpty())
+	{
+		int32 CurrentIndex = Context.OpenSet.Pop();
+		float CurrentDistance = Context.GetDistance(CurrentIndex);
+		Context.SetVisited(CurrentIndex);
+		Context.NumExpanded++;
+		if (CurrentIndex != StartIndex) { OutTileIndices.Add(CurrentIndex); } // dont include the starting tile
+
+		GetBakedNeighbours(CurrentIndex, Capsule, Profile, NeighbouringTiles);
+		for (int32 NIndex : NeighbouringTiles)
+		{
+			if (Context.IsVisited(NIndex) || Context.IsBlocked(NIndex) ||
+				!(TileRecords[NIndex].TraversableMasks & TraversableBit))
+			{
+				continue;
+			}
+
+			float TentativeDistance = TileRecords[NIndex].Cost + CurrentDistance;
+			if (RelaxEdge(Context, CurrentIndex, NIndex, TentativeDistance) && TentativeDistance <= MovementRange)
+			{
+				// inserts N or lowers its priority if it is already in the open set
+				Context.OpenSet.Push(NIndex, TentativeDistance);
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_NavGrid_ExpandedTiles, Context.NumExpanded);
+}
+
+bool ANavGrid::RelaxEdge(FNavGridSearchContext &Context, int32 FromIndex, int32 ToIndex, float TentativeDistance) const
+{
+	float OldDistance = Context.GetDistance(ToIndex);
+	if (TentativeDistance > OldDistance)
+	{
+		return false;
+	}
+
+	//	Prioritize straight paths by using the world distance as a tiebreaker
+	//	when TentativeDistance is equal to the distance we already have
+	if (TentativeDistance == OldDistance)
+	{
+		int32 OldBackpointer = Context.GetBackpointer(ToIndex);
+		if (OldBackpointer != INDEX_NONE)
+		{
+			const FVector &ToLocation = TileRecords[ToIndex].Location;
+			float NewLength = (TileRecords[FromIndex].Location - ToLocation).Size();
+			float OldLength = (TileRecords[OldBackpointer].Location - ToLocation).Size();
+			if (NewLength >= OldLength)
+			{
+				return false;
+			}
+		}
+	}
+
+	Context.SetDistance(ToIndex, TentativeDistance, FromIndex);
+	return true;
+}
+
+bool ANavGrid::FindPath(AGridPawn *Pawn, const UNavTileComponent &Target, float MaxCost, TArray<int32> &OutPath)
+{
+	return FindPath(Pawn, Pawn->GetTile(), Target, MaxCost, PathContext, OutPath);
+}
+
+bool ANavGrid::FindPath(AGridPawn *Pawn, const UNavTileComponent *Start, const UNavTileComponent &Target, float MaxCost, FNavGridSearchContext &Context, TArray<int32> &OutPath)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_FindPath);
+
+	OutPath.Reset();
+
+	int32 StartIndex = Start ? GetTileIndex(*const_cast<UNavTileComponent *>(Start)) : INDEX_NONE;
+	int32 TargetIndex = GetTileIndex(const_cast<UNavTileComponent &>(Target));
+	if (StartIndex == INDEX_NONE || TargetIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	if (MaxCost < 0)
+	{
+		MaxCost = std::numeric_limits<float>::infinity();
+	}
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(Pawn->MovementComponent->AvailableMovementModeFlags.Mask);
+	const UCapsuleComponent &Capsule = *Pawn->MovementCollisionCapsule;
+	const int32 Profile = GetCapsuleProfile(Capsule);
+	TArray<int32> NeighbouringTiles;
+
+	// edges are baked lazily, so the search may find edges that are longer than the heuristic assumed.
+	// The estimates were too high if it did, search again with the new bounds
+	do
+	{
+		UpdateHeuristicBounds();
+		Context.Reset(Tiles.Num());
+		BlockOccupiedTiles(Pawn, Context);
+
+		Context.SetDistance(StartIndex, 0, INDEX_NONE);
+		Context.OpenSet.Push(StartIndex, EstimateCost(StartIndex, TargetIndex));
+		while (!Context.OpenSet.IsEmpty())
+		{
+			int32 CurrentIndex = Context.OpenSet.Pop();
+			if (CurrentIndex == TargetIndex)
+			{
+				break;
+			}
+
+			float CurrentDistance = Context.GetDistance(CurrentIndex);
+			Context.SetVisited(CurrentIndex);
+			Context.NumExpanded++;
+
+			GetBakedNeighbours(CurrentIndex, Capsule, Profile, NeighbouringTiles);
+			for (int32 NIndex : NeighbouringTiles)
+			{
+				if (Context.IsVisited(NIndex) || Context.IsBlocked(NIndex) ||
+					!(TileRecords[NIndex].TraversableMasks & TraversableBit))
+				{
+					continue;
+				}
+
+				float TentativeDistance = TileRecords[NIndex].Cost + CurrentDistance;
+				float Estimate = TentativeDistance + EstimateCost(NIndex, TargetIndex);
+				if (Estimate <= MaxCost && RelaxEdge(Context, CurrentIndex, NIndex, TentativeDistance))
+				{
+					Context.OpenSet.Push(NIndex, Estimate);
+				}
+			}
+		}
+	} while (FMath::Max(TileSize, MaxEdgeLength) > HeuristicStepLength);
+
+	INC_DWORD_STAT_BY(STAT_NavGrid_ExpandedTiles, Context.NumExpanded);
+
+	// tiles are only given a distance if they can be reached within MaxCost
+	if (TargetIndex != StartIndex && Context.GetBackpointer(TargetIndex) == INDEX_NONE)
+	{
+		return false;
+	}
+	for (int32 Index = TargetIndex; Index != INDEX_NONE; Index = Context.GetBackpointer(Index))
+	{
+		OutPath.Add(Index);
+	}
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+void FNavGridRoute::GetLeg(int32 Leg, TArray<const UNavTileComponent *> &OutTiles) const
+{
+	OutTiles.Reset();
+	if (LegEnds.IsValidIndex(Leg))
+	{
+		int32 First = Leg > 0 ? LegEnds[Leg - 1] : 0;
+		for (int32 Idx = First; Idx <= LegEnds[Leg]; Idx++)
+		{
+			OutTiles.Add(Tiles[Idx]);
+		}
+	}
+}
+
+bool ANavGrid::PlanRoute(AGridPawn *Pawn, UNavTileComponent *Target, FNavGridRoute &OutRoute)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_PlanRoute);
+
+	OutRoute = FNavGridRoute();
+	if (!IsValid(Pawn) || !IsValid(Target))
+	{
+		return false;
+	}
+
+	FNavGridRoute *CachedRoute = PlannedRoutes.Find(Pawn);
+	if (CachedRoute && ReuseRoute(Pawn, Target, *CachedRoute))
+	{
+		OutRoute = *CachedRoute;
+		return true;
+	}
+
+	// plan a new route from scratch
+	PlannedRoutes.Remove(Pawn);
+	TArray<int32> PathIndices;
+	bool bFoundPath = bUseHierarchicalPathfinding ?
+		FindPathHierarchical(Pawn, *Target, PathContext, PathIndices) :
+		FindPath(Pawn, *Target, -1, PathIndices);
+	if (!bFoundPath)
+	{
+		return false;
+	}
+	for (int32 Index : PathIndices)
+	{
+		OutRoute.Tiles.Add(GetTileByIndex(Index));
+	}
+	if (!SplitRoute(Pawn, OutRoute))
+	{
+		OutRoute = FNavGridRoute();
+		return false;
+	}
+
+	// drop the routes of pawns that went away without telling us
+	for (auto Itr = PlannedRoutes.CreateIterator(); Itr; ++Itr)
+	{
+		if (!Itr.Key().IsValid())
+		{
+			Itr.RemoveCurrent();
+		}
+	}
+	PlannedRoutes.Add(Pawn, OutRoute);
+	return true;
+}
+
+bool ANavGrid::ReuseRoute(AGridPawn *Pawn, UNavTileComponent *Target, FNavGridRoute &InOutRoute)
+{
+	int32 Position = InOutRoute.Tiles.Find(Pawn->GetTile());
+	if (InOutRoute.GetDestination() != Target || Position == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// the rest of the route must still exist, must not be occupied by anyone else and every step must still be one FindPath() could take
+	FNavGridSearchContext &Context = PathContext;
+	Context.Reset(Tiles.Num());
+	BlockOccupiedTiles(Pawn, Context);
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(Pawn->MovementComponent->AvailableMovementModeFlags.Mask);
+	const UCapsuleComponent &Capsule = *Pawn->MovementCollisionCapsule;
+	const int32 Profile = GetCapsuleProfile(Capsule);
+	for (int32 Idx = Position; Idx < InOutRoute.Tiles.Num(); Idx++)
+	{
+		UNavTileComponent *Tile = InOutRoute.Tiles[Idx];
+		if (!IsValid(Tile) || Tile->GetGrid() != this || Tile->TileIndex == INDEX_NONE || Context.IsBlocked(Tile->TileIndex))
+		{
+			return false;
+		}
+		if (Idx > Position && (!(TileRecords[Tile->TileIndex].TraversableMasks & TraversableBit) ||
+			!IsRouteStepOpen(InOutRoute.Tiles[Idx - 1]->TileIndex, Tile->TileIndex, Capsule, Profile)))
+		{
+			return false;
+		}
+	}
+
+	InOutRoute.Tiles.RemoveAt(0, Position);
+	return SplitRoute(Pawn, InOutRoute);
+}
+
+bool ANavGrid::IsRouteStepOpen(int32 FromIndex, int32 ToIndex, const UCapsuleComponent &Capsule, int32 Profile)
+{
+	// without a profile the search does physics queries, so do a single one for this step
+	if (Profile == INDEX_NONE)
+	{
+		return !IsEdgeObstructed(FromIndex, ToIndex, Capsule, GetBakeResponseParams());
+	}
+
+	const uint32 ProfileBit = 1u << Profile;
+	for (const FNavTileEdge &Edge : GetTileEdges(FromIndex, Capsule, Profile))
+	{
+		if (Edge.TileIndex == ToIndex)
+		{
+			return !(Edge.ObstructedProfiles & ProfileBit);
+		}
+	}
+	return false;
+}
+
+bool ANavGrid::SplitRoute(AGridPawn *Pawn, FNavGridRoute &InOutRoute) const
+{
+	const FGridMovementModes &MovementModes = Pawn->MovementComponent->AvailableMovementModeFlags;
+	const float MovementRange = Pawn->MovementComponent->MovementRange;
+	TArray<UNavTileComponent *> &RouteTiles = InOutRoute.Tiles;
+
+	InOutRoute.LegEnds.Reset();
+	int32 LegStart = 0;
+	while (LegStart < RouteTiles.Num() - 1)
+	{
+		// find the furthest tile within range where we can end the turn
+		int32 LegEnd = INDEX_NONE;
+		float LegCost = 0;
+		for (int32 Idx = LegStart + 1; Idx < RouteTiles.Num(); Idx++)
+		{
+			LegCost += TileRecords[RouteTiles[Idx]->TileIndex].Cost;
+			if (LegCost > MovementRange)
+			{
+				break;
+			}
+			if (RouteTiles[Idx]->LegalPositionAtEndOfTurn(MovementModes))
+			{
+				LegEnd = Idx;
+			}
+		}
+
+		if (LegEnd == INDEX_NONE)
+		{
+			UE_LOG(NavGrid, Verbose, TEXT("%s: Unable to split route into legs, no legal position within range of tile %i"), *Pawn->GetName(), LegStart);
+			return false;
+		}
+		InOutRoute.LegEnds.Add(LegEnd);
+		LegStart = LegEnd;
+	}
+
+	return InOutRoute.LegEnds.Num() > 0;
+}
+
+FNavGridQueryHandle ANavGrid::FindPathAsync(AGridPawn *Pawn, const UNavTileComponent &Target, float MaxCost, FOnNavGridQueryDone OnDone)
+{
+	return StartQuery(Pawn, &Target, MaxCost, OnDone);
+}
+
+FNavGridQueryHandle ANavGrid::K2_FindPathAsync(AGridPawn *Pawn, UNavTileComponent *Target, float MaxCost, FOnNavGridQueryDoneDynamic OnDone)
+{
+	if (!IsValid(Target))
+	{
+		return FNavGridQueryHandle();
+	}
+	return FindPathAsync(Pawn, *Target, MaxCost, FOnNavGridQueryDone::CreateLambda([OnDone](const FNavGridQueryResult &Result)
+	{
+		OnDone.ExecuteIfBound(Result);
+	}));
+}
+
+FNavGridQueryHandle ANavGrid::GetTilesInRangeAsync(AGridPawn *Pawn, FOnNavGridQueryDone OnDone)
+{
+	return StartQuery(Pawn, nullptr, IsValid(Pawn) ? Pawn->MovementComponent->MovementRange : 0, OnDone);
+}
+
+FNavGridQueryHandle ANavGrid::K2_GetTilesInRangeAsync(AGridPawn *Pawn, FOnNavGridQueryDoneDynamic OnDone)
+{
+	return GetTilesInRangeAsync(Pawn, FOnNavGridQueryDone::CreateLambda([OnDone](const FNavGridQueryResult &Result)
+	{
+		OnDone.ExecuteIfBound(Result);
+	}));
+}
+
+void ANavGrid::CancelQuery(FNavGridQueryHandle Handle)
+{
+	FPendingQuery *Query = PendingQueries.Find(Handle.Id);
+	if (Query)
+	{
+		*Query->bCancelled = true;
+		PendingQueries.Remove(Handle.Id);
+	}
+}
+
+TSharedPtr<const FNavGridSnapshot, ESPMode::ThreadSafe> ANavGrid::GetSnapshot(const UCapsuleComponent &Capsule, int32 Profile)
+{
+	check(Profile >= 0 && Profile < 32);
+	const uint32 ProfileBit = 1u << Profile;
+	if (!Snapshot.IsValid() || !(SnapshotProfiles & ProfileBit))
+	{
+		// baking a tile can invalidate the edges of its neighbours, so go over the grid until everything is baked.
+		// Neighbours are only invalidated when they lack an edge back to us, so this settles after a few passes
+		const int32 MaxPasses = 16;
+		bool bAllBaked = false;
+		for (int32 Pass = 0; !bAllBaked && Pass < MaxPasses; Pass++)
+		{
+			bAllBaked = true;
+			for (int32 Idx = 0; Idx < TileRecords.Num(); Idx++)
+			{
+				if (TileRecords[Idx].bRegistered && !(TileRecords[Idx].BakedProfiles & ProfileBit))
+				{
+					GetTileEdges(Idx, Capsule, Profile);
+					bAllBaked = false;
+				}
+			}
+		}
+		if (!bAllBaked)
+		{
+			UE_LOG(NavGrid, Warning, TEXT("%s: Edges did not settle after %i passes, some async queries may use stale edges"), *GetName(), MaxPasses);
+		}
+		Snapshot = MakeShared<FNavGridSnapshot, ESPMode::ThreadSafe>(*this);
+		// reuse the snapshot for this profile even if some edges are stale, rather than baking again for every query
+		SnapshotProfiles = Snapshot->GetBakedProfiles() | ProfileBit;
+	}
+	return Snapshot;
+}
+
+FNavGridQueryHandle ANavGrid::StartQuery(AGridPawn *Pawn, const UNavTileComponent *Target, float MaxCost, FOnNavGridQueryDone OnDone)
+{
+	if (!IsValid(Pawn) || !IsValid(Pawn->MovementCollisionCapsule))
+	{
+		return FNavGridQueryHandle();
+	}
+
+	FNavGridQueryParams Params;
+	UNavTileComponent *Start = Pawn->GetTile();
+	Params.StartIndex = Start ? GetTileIndex(*Start) : INDEX_NONE;
+	Params.TargetIndex = Target ? GetTileIndex(*const_cast<UNavTileComponent *>(Target)) : INDEX_NONE;
+	Params.MaxCost = MaxCost;
+	Params.Profile = GetCapsuleProfile(*Pawn->MovementCollisionCapsule);
+	Params.MovementModeMask = Pawn->MovementComponent->AvailableMovementModeFlags.Mask;
+	if (Params.StartIndex == INDEX_NONE || (Target && Params.TargetIndex == INDEX_NONE) || Params.Profile == INDEX_NONE)
+	{
+		return FNavGridQueryHandle();
+	}
+
+	// occupancy is captured now, so the worker thread never has to look at pawns
+	UpdateUnplacedPawnTiles();
+	for (const auto &Pair : PawnTiles)
+	{
+		if (Tiles.IsValidIndex(Pair.Value) && Pair.Key.Get() != Pawn && Pair.Key.IsValid())
+		{
+			Params.BlockedTiles.Add(Pair.Value);
+		}
+	}
+
+	FNavGridQueryHandle Handle;
+	Handle.Id = NextQueryId++;
+	if (NextQueryId <= 0)
+	{
+		NextQueryId = 1;
+	}
+	FPendingQuery &Query = PendingQueries.Add(Handle.Id);
+	Query.OnDone = OnDone;
+	Query.bCancelled = MakeShared<FThreadSafeBool, ESPMode::ThreadSafe>(false);
+
+	TSharedPtr<const FNavGridSnapshot, ESPMode::ThreadSafe> QuerySnapshot = GetSnapshot(*Pawn->MovementCollisionCapsule, Params.Profile);
+	TSharedPtr<FThreadSafeBool, ESPMode::ThreadSafe> bCancelled = Query.bCancelled;
+	TWeakObjectPtr<ANavGrid> WeakGrid(this);
+	const int32 Id = Handle.Id;
+	FFunctionGraphTask::CreateAndDispatchWhenReady([QuerySnapshot, Params, bCancelled, WeakGrid, Id]()
+	{
+		FNavGridSearchContext Context;
+		TArray<int32> TileIndices;
+		bool bSuccess = QuerySnapshot->Search(Params, *bCancelled, Context, TileIndices);
+		if (*bCancelled)
+		{
+			return;
+		}
+
+		TArray<float> Distances;
+		Distances.Reserve(TileIndices.Num());
+		for (int32 Index : TileIndices)
+		{
+			Distances.Add(Context.GetDistance(Index));
+		}
+		AsyncTask(ENamedThreads::GameThread, [QuerySnapshot, bSuccess, TileIndices, Distances, WeakGrid, Id]()
+		{
+			if (WeakGrid.IsValid())
+			{
+				WeakGrid->FinishQuery(Id, *QuerySnapshot, bSuccess, TileIndices, Distances);
+			}
+		});
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+
+	return Handle;
+}
+
+void ANavGrid::FinishQuery(int32 Id, const FNavGridSnapshot &QuerySnapshot, bool bSuccess, const TArray<int32> &TileIndices, const TArray<float> &Distances)
+{
+	FPendingQuery Query;
+	if (!PendingQueries.RemoveAndCopyValue(Id, Query))
+	{
+		// cancelled
+		return;
+	}
+
+	FNavGridQueryResult Result;
+	Result.Handle.Id = Id;
+	Result.bSuccess = bSuccess;
+	for (int32 Idx = 0; Result.bSuccess && Idx < TileIndices.Num(); Idx++)
+	{
+		// tiles may have been removed while we were searching, and their index given to a tile somewhere else (see RecycleVirtualTile())
+		const int32 TileIndex = TileIndices[Idx];
+		Result.bSuccess = IsValidTileIndex(TileIndex) && TileRecords[TileIndex].Location.Equals(QuerySnapshot.GetLocation(TileIndex));
+		Result.Tiles.Add(Result.bSuccess ? GetTileByIndex(TileIndex) : nullptr);
+		Result.Distances.Add(Distances[Idx]);
+	}
+	if (!Result.bSuccess)
+	{
+		Result.Tiles.Empty();
+		Result.Distances.Empty();
+	}
+	Query.OnDone.ExecuteIfBound(Result);
+}
+
+bool ANavGrid::FindPathHierarchical(AGridPawn *Pawn, const UNavTileComponent &Target, FNavGridSearchContext &Context, TArray<int32> &OutPath)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_FindPathHierarchical);
+
+	UNavTileComponent *Start = Pawn->GetTile();
+	int32 StartIndex = Start ? GetTileIndex(*Start) : INDEX_NONE;
+	int32 TargetIndex = GetTileIndex(const_cast<UNavTileComponent &>(Target));
+	const UCapsuleComponent &Capsule = *Pawn->MovementCollisionCapsule;
+	const int32 Profile = GetCapsuleProfile(Capsule);
+	if (StartIndex != INDEX_NONE && TargetIndex != INDEX_NONE && Profile != INDEX_NONE)
+	{
+		FNavGridHierarchy &Hierarchy = GetHierarchy(Profile, Pawn->MovementComponent->AvailableMovementModeFlags);
+		if (!Hierarchy.InSameCluster(StartIndex, TargetIndex))
+		{
+			if (!Hierarchy.FindPath(StartIndex, TargetIndex, Capsule, Context, OutPath))
+			{
+				// pawns are the only thing the hierarchical graph does not know about, and they only remove paths
+				return false;
+			}
+
+			Context.Reset(Tiles.Num());
+			BlockOccupiedTiles(Pawn, Context);
+			if (!OutPath.ContainsByPredicate([&Context](int32 Index) { return Context.IsBlocked(Index); }))
+			{
+				return true;
+			}
+		}
+	}
+
+	return FindPath(Pawn, Start, Target, -1, Context, OutPath);
+}
+
+FNavGridHierarchy &ANavGrid::GetHierarchy(int32 Profile, const FGridMovementModes &MovementModes)
+{
+	// graphs built with old cluster settings are useless
+	Hierarchies.RemoveAll([](const TUniquePtr<FNavGridHierarchy> &Hierarchy) { return !Hierarchy->HasCurrentClusterSettings(); });
+	for (TUniquePtr<FNavGridHierarchy> &Hierarchy : Hierarchies)
+	{
+		if (Hierarchy->Matches(Profile, MovementModes))
+		{
+			return *Hierarchy;
+		}
+	}
+	return *Hierarchies.Add_GetRef(MakeUnique<FNavGridHierarchy>(*this, Profile, MovementModes));
+}
+
+float ANavGrid::EstimateCost(const UNavTileComponent &From, const UNavTileComponent &To) const
+{
+	// a single edge never covers more than MaxEdgeLength horizontally, and never costs less than MinTileCost
+	FVector Delta = To.GetComponentLocation() - From.GetComponentLocation();
+	return HeuristicTileCost * FMath::Max(FMath::Abs(Delta.X), FMath::Abs(Delta.Y)) / HeuristicStepLength;
+}
+
+float ANavGrid::EstimateCost(int32 FromIndex, int32 ToIndex) const
+{
+	FVector Delta = TileRecords[ToIndex].Location - TileRecords[FromIndex].Location;
+	return HeuristicTileCost * FMath::Max(FMath::Abs(Delta.X), FMath::Abs(Delta.Y)) / HeuristicStepLength;
+}
+
+void ANavGrid::UpdateHeuristicBounds()
+{
+	if (bHeuristicBoundsDirty)
+	{
+		QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_UpdateHeuristicBounds);
+
+		MinTileCost = std::numeric_limits<float>::infinity();
+		MaxEdgeLength = 0;
+		for (const FNavGridTileRecord &Record : TileRecords)
+		{
+			if (!Record.bRegistered)
+			{
+				continue;
+			}
+			MinTileCost = FMath::Min(MinTileCost, Record.Cost);
+			for (const FNavTileEdge &Edge : Record.Edges)
+			{
+				if (IsValidTileIndex(Edge.TileIndex))
+				{
+					const FVector Delta = TileRecords[Edge.TileIndex].Location - Record.Location;
+					MaxEdgeLength = FMath::Max3(MaxEdgeLength, FMath::Abs(Delta.X), FMath::Abs(Delta.Y));
+				}
+			}
+		}
+		bHeuristicBoundsDirty = false;
+	}
+
+	HeuristicTileCost = FMath::IsFinite(MinTileCost) ? FMath::Max(MinTileCost, 0.0f) : 0;
+	HeuristicStepLength = FMath::Max(TileSize, MaxEdgeLength);
+}
+
+bool FNavGridCapsuleProfile::Matches(const UCapsuleComponent &Capsule) const
+{
+	return FMath::IsNearlyEqual(Radius, Capsule.GetScaledCapsuleRadius()) &&
+		FMath::IsNearlyEqual(HalfHeight, Capsule.GetScaledCapsuleHalfHeight()) &&
+		Offset.Equals(Capsule.GetRelativeLocation());
+}
+
+bool FNavGridCapsuleProfile::Matches(const FNavGridCapsuleProfile &Other) const
+{
+	return FMath::IsNearlyEqual(Radius, Other.Radius) && FMath::IsNearlyEqual(HalfHeight, Other.HalfHeight) && Offset.Equals(Other.Offset);
+}
+
+int32 ANavGrid::GetCapsuleProfile(const UCapsuleComponent &Capsule)
+{
+	int32 Profile = CapsuleProfiles.IndexOfByPredicate([&Capsule](const FNavGridCapsuleProfile &P) { return P.Matches(Capsule); });
+	if (Profile == INDEX_NONE && CapsuleProfiles.Num() < 32)
+	{
+		FNavGridCapsuleProfile NewProfile;
+		NewProfile.Radius = Capsule.GetScaledCapsuleRadius();
+		NewProfile.HalfHeight = Capsule.GetScaledCapsuleHalfHeight();
+		NewProfile.Offset = Capsule.GetRelativeLocation();
+		Profile = CapsuleProfiles.Add(NewProfile);
+	}
+	return Profile;
+}
+
+int32 ANavGrid::FindOrAddCapsuleProfile(const FNavGridCapsuleProfile &InProfile)
+{
+	int32 Profile = CapsuleProfiles.IndexOfByPredicate([&InProfile](const FNavGridCapsuleProfile &P) { return P.Matches(InProfile); });
+	if (Profile == INDEX_NONE && CapsuleProfiles.Num() < 32)
+	{
+		Profile = CapsuleProfiles.Add(InProfile);
+	}
+	return Profile;
+}
+
+const TArray<FNavTileEdge> &ANavGrid::GetTileEdges(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile)
+{
+	check(Profile >= 0 && Profile < 32);
+	if (!(TileRecords[TileIndex].BakedProfiles & (1u << Profile)))
+	{
+		BakeTileEdges(TileIndex, Capsule, Profile);
+	}
+	return TileRecords[TileIndex].Edges;
+}
+
+void ANavGrid::GetBakedNeighbours(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile, TArray<int32> &OutNeighbours)
+{
+	// fall back to physics queries if we have run out of profiles
+	if (Profile == INDEX_NONE)
+	{
+		TArray<int32> Obstructed;
+		FindNeighbours(TileIndex, Capsule, GetBakeResponseParams(), OutNeighbours, Obstructed);
+		return;
+	}
+
+	OutNeighbours.Reset();
+	const uint32 ProfileBit = 1u << Profile;
+	for (const FNavTileEdge &Edge : GetTileEdges(TileIndex, Capsule, Profile))
+	{
+		if (!(Edge.ObstructedProfiles & ProfileBit) && IsValidTileIndex(Edge.TileIndex))
+		{
+			OutNeighbours.Add(Edge.TileIndex);
+		}
+	}
+}
+
+void ANavGrid::BakeTileEdges(int32 TileIndex, const UCapsuleComponent &Capsule, int32 Profile)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_BakeTileEdges);
+
+	// may register orphaned tiles, so do this before holding on to any records
+	TArray<int32> UnObstructed, Obstructed;
+	FindNeighbours(TileIndex, Capsule, GetBakeResponseParams(), UnObstructed, Obstructed);
+
+	const uint32 ProfileBit = 1u << Profile;
+	FNavGridTileRecord &Record = TileRecords[TileIndex];
+	TArray<FNavTileEdge> OldEdges = Record.Edges;
+	if (!Record.BakedProfiles)
+	{
+		Record.Edges.Reset();
+	}
+
+	// anything we do not find this time around is no longer reachable for this profile
+	for (FNavTileEdge &Edge : Record.Edges)
+	{
+		Edge.ObstructedProfiles |= ProfileBit;
+	}
+
+	bool bAddedEdges = false;
+	auto UpdateEdge = [&](int32 Neighbour, bool bObstructed)
+	{
+		FNavTileEdge *Edge = Record.Edges.FindByPredicate([Neighbour](const FNavTileEdge &E) { return E.TileIndex == Neighbour; });
+		if (!Edge)
+		{
+			Edge = &Record.Edges.AddDefaulted_GetRef();
+			Edge->TileIndex = Neighbour;
+			Edge->ObstructedProfiles = ~0u;
+			bAddedEdges = true;
+
+			// make sure the neighbour picks up the edge going the other way
+			FNavGridTileRecord &NeighbourRecord = TileRecords[Neighbour];
+			if (!NeighbourRecord.Edges.ContainsByPredicate([TileIndex](const FNavTileEdge &E) { return E.TileIndex == TileIndex; }))
+			{
+				NeighbourRecord.InvalidateEdges();
+			}
+		}
+		if (bObstructed)
+		{
+			Edge->ObstructedProfiles |= ProfileBit;
+		}
+		else
+		{
+			Edge->ObstructedProfiles &= ~ProfileBit;
+		}
+	};
+	for (int32 N : UnObstructed)
+	{
+		UpdateEdge(N, false);
+		FVector Delta = TileRecords[N].Location - Record.Location;
+		MaxEdgeLength = FMath::Max3(MaxEdgeLength, FMath::Abs(Delta.X), FMath::Abs(Delta.Y));
+	}
+	for (int32 N : Obstructed)
+	{
+		UpdateEdge(N, true);
+	}
+
+	// new edges have not been tested against the other profiles
+	Record.BakedProfiles = bAddedEdges ? ProfileBit : Record.BakedProfiles | ProfileBit;
+
+	// the hierarchical graphs only need to know if edges they may already have seen have changed
+	bool bChanged = OldEdges.Num() != Record.Edges.Num();
+	for (int32 Idx = 0; !bChanged && Idx < OldEdges.Num(); Idx++)
+	{
+		bChanged = OldEdges[Idx].TileIndex != Record.Edges[Idx].TileIndex || OldEdges[Idx].ObstructedProfiles != Record.Edges[Idx].ObstructedProfiles;
+	}
+	if (bChanged && OldEdges.Num())
+	{
+		for (TUniquePtr<FNavGridHierarchy> &Hierarchy : Hierarchies)
+		{
+			Hierarchy->MarkDirty(TileIndex);
+		}
+		InvalidateRangeCacheNear(Record.Bounds);
+		// the longest edge may be gone
+		bHeuristicBoundsDirty = true;
+	}
+}
+
+void ANavGrid::FindNeighbours(int32 TileIndex, const UCapsuleComponent &Capsule, const FCollisionResponseParams &ResponseParams, TArray<int32> &OutUnObstructed, TArray<int32> &OutObstructed)
+{
+	OutUnObstructed.Reset();
+	OutObstructed.Reset();
+
+	// components may have their own idea of what their neighbours are, e.g. ladders
+	UNavTileComponent *Tile = FindTileComponent(TileIndex);
+	if (Tile)
+	{
+		TArray<UNavTileComponent *> UnObstructedTiles, ObstructedTiles;
+		Tile->GetNeighbours(Capsule, UnObstructedTiles, ObstructedTiles, ResponseParams);
+		for (UNavTileComponent *N : UnObstructedTiles)
+		{
+			int32 NIndex = GetTileIndex(*N);
+			if (NIndex != INDEX_NONE && NIndex != TileIndex)
+			{
+				OutUnObstructed.AddUnique(NIndex);
+			}
+		}
+		for (UNavTileComponent *N : ObstructedTiles)
+		{
+			int32 NIndex = GetTileIndex(*N);
+			if (NIndex != INDEX_NONE && NIndex != TileIndex)
+			{
+				OutObstructed.AddUnique(NIndex);
+			}
+		}
+	}
+
+	// tiles without a component have no collision for GetNeighbours() to find, see UNavTileComponent::GetNeighbours() for the reach
+	TArray<int32> Nearby;
+	GetTilesNear(TileRecords[TileIndex].Bounds.ExpandBy(TileSize * 0.75f), Nearby);
+	for (int32 NIndex : Nearby)
+	{
+		if (NIndex == TileIndex || (Tile && Tiles[NIndex]))
+		{
+			continue;
+		}
+		if (IsEdgeObstructed(TileIndex, NIndex, Capsule, ResponseParams))
+		{
+			OutObstructed.Add(NIndex);
+		}
+		else
+		{
+			OutUnObstructed.Add(NIndex);
+		}
+	}
+}
+
+bool ANavGrid::IsEdgeObstructed(int32 FromIndex, int32 ToIndex, const UCapsuleComponent &Capsule, const FCollisionResponseParams &ResponseParams) const
+{
+	const FVector From = TileRecords[FromIndex].GetPawnLocation();
+	const FVector To = TileRecords[ToIndex].GetPawnLocation();
+	if (const UNavTileComponent *ToTile = Tiles[ToIndex])
+	{
+		return ToTile->Obstructed(From, Capsule, ResponseParams);
+	}
+	// the sweep is the same in both directions, let the tile pick where it starts, e.g. the top or bottom of a ladder
+	if (const UNavTileComponent *FromTile = Tiles[FromIndex])
+	{
+		return FromTile->Obstructed(To, Capsule, ResponseParams);
+	}
+	const FVector CapsuleOffset = Capsule.GetRelativeLocation();
+	return TileClass->GetDefaultObject<UNavTileComponent>()->Obstructed(From + CapsuleOffset, To + CapsuleOffset, Capsule, ResponseParams);
+}
+
+void ANavGrid::BakeNeighbourGraph()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_BakeNeighbourGraph);
+
+	// tile costs may have been changed since the tiles were registered
+	for (UNavTileComponent *Tile : Tiles)
+	{
+		if (Tile)
+		{
+			UpdateTileRecord(*Tile);
+		}
+	}
+	bHeuristicBoundsDirty = true;
+
+	for (TActorIterator<AGridPawn> Itr(GetWorld()); Itr; ++Itr)
+	{
+		const UCapsuleComponent *Capsule = Itr->MovementCollisionCapsule;
+		int32 Profile = IsValid(Capsule) ? GetCapsuleProfile(*Capsule) : INDEX_NONE;
+		if (Profile != INDEX_NONE)
+		{
+			for (int32 Idx = 0; Idx < TileRecords.Num(); Idx++)
+			{
+				if (TileRecords[Idx].bRegistered)
+				{
+					GetTileEdges(Idx, *Capsule, Profile);
+				}
+			}
+		}
+	}
+}
+
+void ANavGrid::ClearNeighbourGraph()
+{
+	for (FNavGridTileRecord &Record : TileRecords)
+	{
+		Record.Edges.Empty();
+		Record.InvalidateEdges();
+	}
+	CapsuleProfiles.Empty();
+	Hierarchies.Empty();
+	InvalidateRangeCache();
+	bHeuristicBoundsDirty = true;
+}
+
+const FCollisionResponseParams &ANavGrid::GetBakeResponseParams()
+{
+	static FCollisionResponseParams ResponseParams = []()
+	{
+		FCollisionResponseParams Params;
+		Params.CollisionResponse.SetResponse(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Ignore);
+		return Params;
+	}();
+	return ResponseParams;
+}
+
+void ANavGrid::BlockOccupiedTiles(const AGridPawn *IgnoredPawn, FNavGridSearchContext &Context)
+{
+	UpdateUnplacedPawnTiles();
+	for (const auto &Pair : PawnTiles)
+	{
+		if (Tiles.IsValidIndex(Pair.Value) && Pair.Key.Get() != IgnoredPawn && Pair.Key.IsValid())
+		{
+			Context.SetBlocked(Pair.Value);
+		}
+	}
+}
+
+void ANavGrid::RegisterTile(UNavTileComponent *Tile)
+{
+	check(Tile->TileIndex == INDEX_NONE);
+	if (IsValidTileIndex(AdoptedTileIndex) && !Tiles[AdoptedTileIndex])
+	{
+		// a component for a tile that only existed as a record, see GetTileByIndex(). It matches the record already
+		Tile->TileIndex = AdoptedTileIndex;
+		Tiles[Tile->TileIndex] = Tile;
+		AdoptedTileIndex = INDEX_NONE;
+		return;
+	}
+
+	if (FreeTileIndices.Num())
+	{
+		Tile->TileIndex = FreeTileIndices.Pop(false);
+		Tiles[Tile->TileIndex] = Tile;
+	}
+	else
+	{
+		Tile->TileIndex = Tiles.Add(Tile);
+		TileRecords.AddDefaulted();
+	}
+	FNavGridTileRecord &Record = TileRecords[Tile->TileIndex];
+	Record = FNavGridTileRecord();
+	Record.bRegistered = true;
+	Tile->GetTileRecord(Record);
+	TilePlacementChanged(Tile->TileIndex, FBox(ForceInit));
+}
+
+int32 ANavGrid::AddTileRecord(const FVector &Location, const FVector &Extent)
+{
+	// Traversable() only depends on the movement modes of the pawn, so the default object answers for every tile of its class
+	if (DefaultTileRecordClass != TileClass)
+	{
+		DefaultTileRecord = FNavGridTileRecord();
+		TileClass->GetDefaultObject<UNavTileComponent>()->GetTileRecord(DefaultTileRecord);
+		DefaultTileRecordClass = TileClass;
+	}
+
+	int32 Index;
+	if (FreeTileIndices.Num())
+	{
+		Index = FreeTileIndices.Pop(false);
+	}
+	else
+	{
+		Index = Tiles.Add(nullptr);
+		TileRecords.AddDefaulted();
+	}
+	FNavGridTileRecord &Record = TileRecords[Index];
+	Record = FNavGridTileRecord();
+	Record.bRegistered = true;
+	Record.Location = Location;
+	Record.Extent = Extent;
+	Record.Bounds = FBox(Location - Extent, Location + Extent);
+	Record.PawnOffset = DefaultTileRecord.PawnOffset;
+	Record.Cost = DefaultTileRecord.Cost;
+	Record.TraversableMasks = DefaultTileRecord.TraversableMasks;
+	TilePlacementChanged(Index, FBox(ForceInit));
+	return Index;
+}
+
+void ANavGrid::UnregisterTile(UNavTileComponent *Tile)
+{
+	if (Tiles.IsValidIndex(Tile->TileIndex) && Tiles[Tile->TileIndex] == Tile)
+	{
+		RemoveTileHighlights(*Tile);
+		UnregisterTileIndex(Tile->TileIndex);
+	}
+	Tile->TileIndex = INDEX_NONE;
+}
+
+void ANavGrid::UnregisterTileIndex(int32 Index)
+{
+	check(IsValidTileIndex(Index));
+	FNavGridTileRecord &Record = TileRecords[Index];
+	RemoveFromSpatialIndex(Index);
+	if (Record.bVirtual)
+	{
+		// the component of a virtual tile was destroyed by someone else
+		VirtualTiles.RemoveSingleSwap(Index, false);
+	}
+	// the index may be handed to another tile, which must not be blocked by pawns that stood on this one
+	for (auto &Pair : PawnTiles)
+	{
+		if (Pair.Value == Index)
+		{
+			TotalOccupancyHash -= HashOccupiedTile(Pair.Value);
+			Pair.Value = INDEX_NONE;
+		}
+	}
+
+	// neighbours must drop their edges to this tile
+	for (const FNavTileEdge &Edge : Record.Edges)
+	{
+		if (IsValidTileIndex(Edge.TileIndex))
+		{
+			TileRecords[Edge.TileIndex].InvalidateEdges();
+		}
+	}
+	const FBox Bounds = Record.Bounds;
+	Record = FNavGridTileRecord();
+	Tiles[Index] = nullptr;
+	FreeTileIndices.Add(Index);
+	for (TUniquePtr<FNavGridHierarchy> &Hierarchy : Hierarchies)
+	{
+		Hierarchy->UpdateTile(Index);
+	}
+	InvalidateRangeCacheNear(Bounds);
+	InvalidateEdgesNear(Bounds);
+	bHeuristicBoundsDirty = true;
+}
+
+UNavTileComponent *ANavGrid::GetTileByIndex(int32 Index)
+{
+	if (!IsValidTileIndex(Index))
+	{
+		return nullptr;
+	}
+	if (!Tiles[Index])
+	{
+		const FNavGridTileRecord &Record = TileRecords[Index];
+		UNavTileComponent *TileComp = TakePooledTile();
+		if (!TileComp)
+		{
+			TileComp = NewObject<UNavTileComponent>(this, TileClass);
+			TileComp->SetupAttachment(GetRootComponent());
+		}
+		TileComp->SetWorldTransform(FTransform(Record.Rotation, Record.Location));
+		TileComp->SetBoxExtent(Record.Extent);
+
+		// RegisterTile() gives the component this index instead of a new one
+		TGuardValue<int32> Adopt(AdoptedTileIndex, Index);
+		TileComp->RegisterComponentWithWorld(GetWorld());
+		TileComp->SetGrid(this);
+		check(Tiles[Index] == TileComp);
+	}
+	return Tiles[Index];
+}
+
+void ANavGrid::UpdateTileLocation(UNavTileComponent *Tile)
+{
+	// only the placement can change with the transform, Traversable() is not asked again
+	FNavGridTileRecord &Record = TileRecords[Tile->TileIndex];
+	const FBox OldBounds = Record.Bounds;
+	Tile->GetTilePlacement(Record);
+	TilePlacementChanged(Tile->TileIndex, OldBounds);
+	UpdateTileHighlights(*Tile);
+}
+
+void ANavGrid::TilePlacementChanged(int32 Index, const FBox &OldBounds)
+{
+	// tiles around both the old and the new location may gain or lose edges to this tile
+	const FNavGridTileRecord &Record = TileRecords[Index];
+	UpdateSpatialIndex(Index);
+	InvalidateEdgesNear(OldBounds);
+	InvalidateEdgesNear(Record.Bounds);
+	// edges to and from this tile have changed length
+	bHeuristicBoundsDirty = true;
+	for (TUniquePtr<FNavGridHierarchy> &Hierarchy : Hierarchies)
+	{
+		Hierarchy->UpdateTile(Index);
+	}
+	InvalidateRangeCacheNear(OldBounds);
+	InvalidateRangeCacheNear(Record.Bounds);
+	bPawnTilesStale = PawnTiles.Num() > 0;
+	MinTileCost = GetNumTiles() > 1 ? FMath::Min(MinTileCost, Record.Cost) : Record.Cost;
+}
+
+void ANavGrid::UpdateTileRecord(UNavTileComponent &Tile)
+{
+	check(Tile.GetGrid() == this && Tiles.IsValidIndex(Tile.TileIndex));
+	FNavGridTileRecord &Record = TileRecords[Tile.TileIndex];
+	const float OldCost = Record.Cost;
+	const uint32 OldTraversableMasks = Record.TraversableMasks;
+	const FBox OldBounds = Record.Bounds;
+	Tile.GetTileRecord(Record);
+	UpdateSpatialIndex(Tile.TileIndex);
+	if (Record.Cost < MinTileCost)
+	{
+		MinTileCost = Record.Cost;
+	}
+	else if (Record.Cost > OldCost)
+	{
+		// this may have been the cheapest tile
+		bHeuristicBoundsDirty = true;
+	}
+	if (Record.Cost != OldCost || Record.TraversableMasks != OldTraversableMasks)
+	{
+		for (TUniquePtr<FNavGridHierarchy> &Hierarchy : Hierarchies)
+		{
+			Hierarchy->MarkDirty(Tile.TileIndex);
+		}
+	}
+	InvalidateRangeCacheNear(OldBounds);
+	InvalidateRangeCacheNear(Record.Bounds);
+}
+
+void ANavGrid::UpdateSpatialIndex(int32 TileIndex)
+{
+	if (SpatialCellSize != TileSize)
+	{
+		// the whole index is rebuilt the next time it is used
+		return;
+	}
+
+	FNavGridTileRecord &Record = TileRecords[TileIndex];
+	const FBox &Box = Record.Bounds;
+	FIntRect Cells(GetSpatialCell(Box.Min.X, Box.Min.Y), GetSpatialCell(Box.Max.X, Box.Max.Y));
+	if (Record.bSpatiallyIndexed && Record.SpatialCells == Cells)
+	{
+		return;
+	}
+
+	RemoveFromSpatialIndex(TileIndex);
+	for (int32 X = Cells.Min.X; X <= Cells.Max.X; X++)
+	{
+		for (int32 Y = Cells.Min.Y; Y <= Cells.Max.Y; Y++)
+		{
+			SpatialIndex.FindOrAdd(FIntPoint(X, Y)).Add(TileIndex);
+		}
+	}
+	Record.SpatialCells = Cells;
+	Record.bSpatiallyIndexed = true;
+}
+
+void ANavGrid::RemoveFromSpatialIndex(int32 TileIndex)
+{
+	FNavGridTileRecord &Record = TileRecords[TileIndex];
+	if (!Record.bSpatiallyIndexed)
+	{
+		return;
+	}
+
+	const FIntRect &Cells = Record.SpatialCells;
+	for (int32 X = Cells.Min.X; X <= Cells.Max.X; X++)
+	{
+		for (int32 Y = Cells.Min.Y; Y <= Cells.Max.Y; Y++)
+		{
+			FIntPoint Key(X, Y);
+			auto *Cell = SpatialIndex.Find(Key);
+			if (Cell)
+			{
+				Cell->RemoveSingleSwap(TileIndex, false);
+				if (!Cell->Num())
+				{
+					SpatialIndex.Remove(Key);
+				}
+			}
+		}
+	}
+	Record.bSpatiallyIndexed = false;
+}
+
+void ANavGrid::RebuildSpatialIndex()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_RebuildSpatialIndex);
+
+	SpatialIndex.Empty();
+	SpatialCellSize = TileSize;
+	for (int32 Idx = 0; Idx < TileRecords.Num(); Idx++)
+	{
+		if (TileRecords[Idx].bRegistered)
+		{
+			TileRecords[Idx].bSpatiallyIndexed = false;
+			UpdateSpatialIndex(Idx);
+		}
+	}
+}
+
+void ANavGrid::GetTilesNear(const FBox &Bounds, TArray<int32> &OutTileIndices)
+{
+	OutTileIndices.Reset();
+	if (!Bounds.IsValid)
+	{
+		return;
+	}
+	if (SpatialCellSize != TileSize)
+	{
+		RebuildSpatialIndex();
+	}
+
+	const FIntPoint MinCell = GetSpatialCell(Bounds.Min.X, Bounds.Min.Y);
+	const FIntPoint MaxCell = GetSpatialCell(Bounds.Max.X, Bounds.Max.Y);
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const auto *Cell = SpatialIndex.Find(FIntPoint(X, Y));
+			if (!Cell)
+			{
+				continue;
+			}
+			for (int32 Index : *Cell)
+			{
+				// tiles that cover several cells are found more than once
+				if (TileRecords[Index].Bounds.Intersect(Bounds))
+				{
+					OutTileIndices.AddUnique(Index);
+				}
+			}
+		}
+	}
+}
+
+void ANavGrid::InvalidateEdgesNear(const FBox &Bounds)
+{
+	// GetNeighbours() looks for tiles within TileSize * 0.75 of a tile's extent
+	TArray<int32> Nearby;
+	GetTilesNear(Bounds.ExpandBy(TileSize), Nearby);
+	for (int32 Index : Nearby)
+	{
+		TileRecords[Index].InvalidateEdges();
+	}
+}
+
+FIntPoint ANavGrid::GetSpatialCell(float X, float Y) const
+{
+	return FIntPoint(FMath::FloorToInt(X / SpatialCellSize), FMath::FloorToInt(Y / SpatialCellSize));
+}
+
+void ANavGrid::GetAllTiles(TArray<UNavTileComponent *> &OutTiles)
+{
+	OutTiles.Reset(GetNumTiles());
+	for (int32 Idx = 0; Idx < TileRecords.Num(); Idx++)
+	{
+		if (TileRecords[Idx].bRegistered)
+		{
+			OutTiles.Add(GetTileByIndex(Idx));
+		}
+	}
+}
+
+int32 ANavGrid::GetTileIndex(UNavTileComponent &Tile)
+{
+	if (!Tile.GetGrid())
+	{
+		Tile.SetGrid(this);
+	}
+	return Tile.GetGrid() == this ? Tile.TileIndex : INDEX_NONE;
+}
+
+void ANavGrid::GetTilesInRange(AGridPawn *Pawn, TArray<UNavTileComponent*>& OutTiles)
+{
+	if (Pawn != CurrentPawn || GetRangeCacheKey(Pawn) != CurrentRangeKey || GetOccupancyHash(Pawn) != CurrentOccupancyHash)
+	{
+		CalculateTilesInRange(Pawn);
+	}
+	OutTiles.Reset(TilesInRange.Num());
+	for (int32 Index : TilesInRange)
+	{
+		OutTiles.Add(GetTileByIndex(Index));
+	}
+}
+
+void ANavGrid::GetCompleteTilesInRange(AGridPawn *Pawn, TArray<UNavTileComponent *> &OutTiles)
+{
+	// place everything in one go, both for a job that is already running and for any job started by the range search
+	TGuardValue<float> UnlimitedBudget(VirtualTileBudgetMicroseconds, 0);
+	if (IsGeneratingVirtualTiles(Pawn))
+	{
+		CompleteVirtualTileJob();
+	}
+	if (bTilesInRangeProvisional && CurrentPawn == Pawn)
+	{
+		// the job was replaced by one for another pawn before it finished
+		CurrentPawn = nullptr;
+	}
+	GetTilesInRange(Pawn, OutTiles);
+}
+
+float ANavGrid::GetDistance(const UNavTileComponent &Tile) const
+{
+	return Tile.GetGrid() == this ? RangeContext.GetDistance(Tile.TileIndex) : std::numeric_limits<float>::infinity();
+}
+
+UNavTileComponent *ANavGrid::GetBackpointer(const UNavTileComponent &Tile)
+{
+	return Tile.GetGrid() == this ? GetTileByIndex(RangeContext.GetBackpointer(Tile.TileIndex)) : nullptr;
+}
+
+bool ANavGrid::IsVisited(const UNavTileComponent &Tile) const
+{
+	return Tile.GetGrid() == this && RangeContext.IsVisited(Tile.TileIndex);
+}
+
+void ANavGrid::ClearTiles()
+{
+	TilesInRange.Empty();
+	RangeContext.Reset(Tiles.Num());
+	CurrentPawn = nullptr;
+	CurrentTile = nullptr;
+	bTilesInRangeProvisional = false;
+
+	ClearTileHighlights();
+	NumPersistentTiles = GetNumTiles() - VirtualTiles.Num();
+}
+
+bool ANavGrid::TraceTileLocation(const FVector & TraceStart, const FVector & TraceEnd, FVector & OutTilePos)
+{
+	FCollisionQueryParams CQP;
+	CQP.bFindInitialOverlaps = true;
+	CQP.TraceTag = "NavGridTilePlacement";
+	FHitResult HitResult;
+
+	GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, ECollisionChannel::ECC_Pawn, CQP);
+	bool bHasDisableTileTag = false;
+	if (IsValid(HitResult.GetActor()))
+	{
+		bHasDisableTileTag = HitResult.GetActor()->ActorHasTag(DisableVirtualTilesTag);
+	}
+
+	OutTilePos = HitResult.ImpactPoint;
+	// return true if we hit the 'outside' of something that does not have the disabletile-tag
+	return HitResult.bBlockingHit && !HitResult.bStartPenetrating && !bHasDisableTileTag;
+}
+
+UNavTileComponent * ANavGrid::PlaceTile(const FVector & Location, AActor * TileOwner)
+{
+	if (!TileOwner)
+	{
+		TileOwner = this;
+	}
+
+	UNavTileComponent *TileComp = TileOwner == this ? TakePooledTile() : nullptr;
+	if (!TileComp)
+	{
+		TileComp = NewObject<UNavTileComponent>(TileOwner, TileClass);
+		TileComp->SetupAttachment(TileOwner->GetRootComponent());
+	}
+	TileComp->SetWorldTransform(FTransform::Identity);
+	TileComp->SetWorldLocation(Location);
+	TileComp->SetBoxExtent(FVector(TileSize / 2, TileSize / 2, 5));
+	TileComp->RegisterComponentWithWorld(TileOwner->GetWorld());
+	TileComp->SetGrid(this);
+
+	return TileComp;
+}
+
+UNavTileComponent * ANavGrid::ConsiderPlaceTile(const FVector &TraceStart, const FVector &TraceEnd, AActor * TileOwner /*= NULL*/)
+{
+	if (!TileOwner)
+	{
+		TileOwner = this;
 	}
 
 	FVector TileLocation;
 	bool FoundGoodLocation = TraceTileLocation(TraceStart, TraceEnd, TileLocation);
 	if (FoundGoodLocation)
 	{
-		// check if we a new tile will overlap any existing tiles
-		// use a mutlisweep as tiles returs overlap responses to this channel
-		TArray<FHitResult> HitResults;
-		FCollisionShape TileShape = FCollisionShape::MakeBox(FVector(TileSize / 3, TileSize / 3, 25));
-		GetWorld()->SweepMultiByChannel(HitResults, TileLocation, TileLocation - FVector(0, 0, 1), FQuat::Identity, ECC_NavGridWalkable, TileShape);
-
-		UNavTileComponent* ExistingTile = nullptr;
-		for (FHitResult& HitResult : HitResults)
-		{
-			if (IsValid(ExistingTile = Cast<UNavTileComponent>(HitResult.Component.Get())))
-			{
-				break;
-			}
-		}
-
-		if (!IsValid(ExistingTile))
+		// check if we a new tile will overlap any existing tiles. Virtual tiles have no collision, so look in the spatial index
+		int32 ExistingIndex = FindOverlappingTile(TileLocation, FVector(TileSize / 3, TileSize / 3, 25));
+		if (ExistingIndex == INDEX_NONE)
 		{
 			return PlaceTile(TileLocation, TileOwner);
 		}
+		TileRecords[ExistingIndex].LastVirtualTileUse = GFrameCounter;
 	}
 
 
 	return nullptr;
 }
 
+int32 ANavGrid::ConsiderPlaceVirtualTile(const FVector &TraceStart, const FVector &TraceEnd)
+{
+	FVector TileLocation;
+	if (!TraceTileLocation(TraceStart, TraceEnd, TileLocation))
+	{
+		return INDEX_NONE;
+	}
+
+	int32 ExistingIndex = FindOverlappingTile(TileLocation, FVector(TileSize / 3, TileSize / 3, 25));
+	if (ExistingIndex != INDEX_NONE)
+	{
+		TileRecords[ExistingIndex].LastVirtualTileUse = GFrameCounter;
+		return INDEX_NONE;
+	}
+
+	// only keep a reasonable number
+	if (VirtualTiles.Num() >= MaxVirtualTiles)
+	{
+		EvictVirtualTiles(FMath::Max(MaxVirtualTiles / VirtualTileEvictionDivisor, 1));
+	}
+	int32 Index = AddTileRecord(TileLocation, FVector(TileSize / 2, TileSize / 2, 5));
+	TileRecords[Index].bVirtual = true;
+	TileRecords[Index].LastVirtualTileUse = GFrameCounter;
+	return Index;
+}
+
+int32 ANavGrid::FindOverlappingTile(const FVector &Location, const FVector &Extent)
+{
+	TArray<int32> Overlapping;
+	GetTilesNear(FBox(Location - Extent, Location + Extent), Overlapping);
+	return Overlapping.Num() ? Overlapping[0] : INDEX_NONE;
+}
+
 FVector ANavGrid::AdjustToTileLocation(const FVector &Location)
 {
-	UNavTileComponent *SnapTile = LineTraceTile(Location, true, 100, 100);
+	UNavTileComponent *SnapTile = GetTile(Location, true, 100, 100);
 	if (SnapTile)
 	{
 		return SnapTile->GetComponentLocation();
@@ -388,62 +2174,537 @@ FVector ANavGrid::AdjustToTileLocation(const FVector &Location)
 
 void ANavGrid::GenerateVirtualTiles(const AGridPawn *Pawn)
 {
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_GenerateVirtualTiles);
-
-	// only keep a reasonable number
-	if (VirtualTiles.Num() > MaxVirtualTiles)
+	FVector Center = AdjustToTileLocation(Pawn->GetActorLocation());
+	int32 Radius = FMath::Max(FMath::FloorToInt(Pawn->MovementComponent->MovementRange), 0);
+	if (IsGeneratingVirtualTiles(Pawn) && VirtualTileJob.Center == Center && VirtualTileJob.Radius == Radius)
+	{
+		// already working on it, Tick() will place the rest
+		return;
+	}
+	if (GeneratedRadius == Radius && GeneratedCenter == Center)
 	{
-		UE_LOG(NavGrid, Log, TEXT("Limit reached (%i), removing all virtual tiles"), MaxVirtualTiles);
-		DestroyVirtualTiles();
+		// nothing has changed since these tiles were placed
+		return;
 	}
 
+	// the range search needs a starting tile right away
 	GenerateVirtualTile(Pawn);
 
-	FVector Center = AdjustToTileLocation(Pawn->GetActorLocation());
+	VirtualTileJob = FVirtualTileJob();
+	VirtualTileJob.Pawn = Pawn;
+	VirtualTileJob.Center = Center;
+	VirtualTileJob.Radius = Radius;
+	VirtualTileJob.bActive = true;
+	// small ranges usually finish within the first slice. Tick() places the rest and triggers OnVirtualTilesGenerated
+	RunVirtualTileJob();
+	SetActorTickEnabled(true);
+}
+
+bool ANavGrid::IsGeneratingVirtualTiles(const AGridPawn *Pawn) const
+{
+	return VirtualTileJob.bActive && VirtualTileJob.Pawn.Get() == Pawn;
+}
+
+void ANavGrid::RunVirtualTileJob()
+{
+	SCOPE_CYCLE_COUNTER(STAT_NavGrid_GenerateVirtualTiles);
+
+	if (!VirtualTileJob.Pawn.IsValid())
+	{
+		CancelVirtualTileJob();
+		return;
+	}
 
-	FVector Min = Center - FVector(Pawn->MovementComponent->MovementRange * TileSize);
-	FVector Max = Center + FVector(Pawn->MovementComponent->MovementRange * TileSize);
-	for (float X = Min.X; X <= Max.X; X += TileSize)
+	const bool bUnlimited = VirtualTileBudgetMicroseconds <= 0;
+	const double EndTime = FPlatformTime::Seconds() + VirtualTileBudgetMicroseconds / 1000000.0;
+	int32 NumTraces = 0;
+	do
 	{
-		for (float Y = Min.Y; Y <= Max.Y; Y += TileSize)
+		FIntPoint Cell = VirtualTileJob.GetCellOffset();
+		FVector Location = VirtualTileJob.Center + FVector(Cell.X, Cell.Y, VirtualTileJob.Radius - VirtualTileJob.ZStep) * TileSize;
+		if (!IsInBakedArea(Location))
 		{
-			for (float Z = Max.Z; Z >= Min.Z; Z -= TileSize)
+			int32 TileIndex = ConsiderPlaceVirtualTile(Location + FVector(0, 0, TileSize), Location - FVector(0, 0, 0.1));
+			if (TileIndex != INDEX_NONE)
 			{
-				UNavTileComponent *TileComp = ConsiderPlaceTile(FVector(X, Y, Z + TileSize), FVector(X, Y, Z - 0.1));
-				if (TileComp)
-				{
-					VirtualTiles.Add(TileComp);
-				}
+				VirtualTiles.Add(TileIndex);
 			}
+			NumTraces++;
+		}
+		VirtualTileJob.bActive = VirtualTileJob.Advance();
+	} while (VirtualTileJob.bActive && (bUnlimited || FPlatformTime::Seconds() < EndTime));
+
+	INC_DWORD_STAT_BY(STAT_NavGrid_VirtualTileTraces, NumTraces);
+	SET_DWORD_STAT(STAT_NavGrid_PendingVirtualTileTraces, VirtualTileJob.bActive ? VirtualTileJob.GetNumPendingTraces() : 0);
+	SET_DWORD_STAT(STAT_NavGrid_VirtualTiles, VirtualTiles.Num());
+	SET_DWORD_STAT(STAT_NavGrid_PooledVirtualTiles, VirtualTilePool.Num());
+}
+
+void ANavGrid::CompleteVirtualTileJob()
+{
+	if (VirtualTileJob.bActive)
+	{
+		TGuardValue<float> UnlimitedBudget(VirtualTileBudgetMicroseconds, 0);
+		RunVirtualTileJob();
+		FinishVirtualTileJob();
+	}
+}
+
+void ANavGrid::FinishVirtualTileJob()
+{
+	const AGridPawn *Pawn = VirtualTileJob.Pawn.Get();
+	VirtualTileJob.Pawn = nullptr;
+	GeneratedCenter = VirtualTileJob.Center;
+	GeneratedRadius = VirtualTileJob.Radius;
+	if (Pawn)
+	{
+		// let GetTilesInRange() replace the provisional result
+		if (bTilesInRangeProvisional && CurrentPawn == Pawn)
+		{
+			CurrentPawn = nullptr;
+		}
+		OnVirtualTilesGenerated.Broadcast(Pawn);
+	}
+}
+
+void ANavGrid::InvalidateGeneratedArea(const FBox &Bounds)
+{
+	if (GeneratedRadius != INDEX_NONE)
+	{
+		// the traces of the job reach one tile beyond its radius, see RunVirtualTileJob()
+		const FBox Area = FBox(GeneratedCenter, GeneratedCenter).ExpandBy((GeneratedRadius + 1) * TileSize);
+		if (Area.Intersect(Bounds))
+		{
+			GeneratedRadius = INDEX_NONE;
 		}
 	}
 }
 
+void ANavGrid::CancelVirtualTileJob()
+{
+	VirtualTileJob = FVirtualTileJob();
+	SET_DWORD_STAT(STAT_NavGrid_PendingVirtualTileTraces, 0);
+}
+
+FIntPoint ANavGrid::FVirtualTileJob::GetCellOffset() const
+{
+	if (Ring == 0)
+	{
+		return FIntPoint(0, 0);
+	}
+
+	// walk the four sides of the ring, each side ends just before the next corner
+	const int32 SideLength = 2 * Ring;
+	const int32 Offset = RingCell % SideLength;
+	switch (RingCell / SideLength)
+	{
+	case 0:
+		return FIntPoint(-Ring + Offset, -Ring);
+	case 1:
+		return FIntPoint(Ring, -Ring + Offset);
+	case 2:
+		return FIntPoint(Ring - Offset, Ring);
+	default:
+		return FIntPoint(-Ring, Ring - Offset);
+	}
+}
+
+bool ANavGrid::FVirtualTileJob::Advance()
+{
+	if (++ZStep <= 2 * Radius)
+	{
+		return true;
+	}
+	ZStep = 0;
+	if (++RingCell < FMath::Max(8 * Ring, 1))
+	{
+		return true;
+	}
+	RingCell = 0;
+	return ++Ring <= Radius;
+}
+
+int32 ANavGrid::FVirtualTileJob::GetNumPendingTraces() const
+{
+	const int32 NumZSteps = 2 * Radius + 1;
+	const int32 NumCells = FMath::Square(2 * Radius + 1);
+	const int32 CellsBeforeRing = Ring > 0 ? FMath::Square(2 * Ring - 1) : 0;
+	return (NumCells - CellsBeforeRing - RingCell) * NumZSteps - ZStep;
+}
+
 void ANavGrid::GenerateVirtualTile(const AGridPawn * Pawn)
 {
 	FVector Location = AdjustToTileLocation(Pawn->GetActorLocation());
-	UNavTileComponent *TileComp = ConsiderPlaceTile(Location + FVector(0, 0, TileSize), Location - FVector(0, 0, 0.1));
-	if (TileComp)
+	if (IsInBakedArea(Location))
+	{
+		return;
+	}
+	int32 TileIndex = ConsiderPlaceVirtualTile(Location + FVector(0, 0, TileSize), Location - FVector(0, 0, 0.1));
+	if (TileIndex != INDEX_NONE)
 	{
-		VirtualTiles.Add(TileComp);
+		VirtualTiles.Add(TileIndex);
 	}
 }
 
 void ANavGrid::DestroyVirtualTiles()
 {
-	for (UNavTileComponent *T : VirtualTiles)
+	for (int32 TileIndex : TArray<int32>(MoveTemp(VirtualTiles)))
+	{
+		RecycleVirtualTile(TileIndex);
+	}
+	VirtualTiles.Empty();
+	for (UNavTileComponent *T : VirtualTilePool)
 	{
 		if (IsValid(T))
 		{
 			T->DestroyComponent();
 		}
 	}
-	VirtualTiles.Empty();
+	VirtualTilePool.Empty();
+	SET_DWORD_STAT(STAT_NavGrid_VirtualTiles, 0);
+	SET_DWORD_STAT(STAT_NavGrid_PooledVirtualTiles, 0);
+}
+
+void ANavGrid::EvictVirtualTiles(int32 NumNeeded)
+{
+	int32 NumToEvict = FMath::Min(VirtualTiles.Num() + NumNeeded - MaxVirtualTiles, VirtualTiles.Num());
+	if (NumToEvict <= 0)
+	{
+		return;
+	}
+
+	// pawns must not lose the tile they stand on or the tiles ahead of them
+	TArray<FVector> PawnLocations;
+	TSet<int32> InUse;
+	auto AddInUse = [this, &InUse](const UNavTileComponent *Tile)
+	{
+		if (Tile && Tile->GetGrid() == this && Tile->TileIndex != INDEX_NONE)
+		{
+			InUse.Add(Tile->TileIndex);
+		}
+	};
+	for (TActorIterator<AGridPawn> Itr(GetWorld()); Itr; ++Itr)
+	{
+		PawnLocations.Add(Itr->GetActorLocation());
+		if (IsValid(Itr->MovementComponent))
+		{
+			AddInUse(Itr->MovementComponent->GetCachedTile());
+			for (const UNavTileComponent *Tile : Itr->MovementComponent->GetPathTiles())
+			{
+				AddInUse(Tile);
+			}
+		}
+	}
+
+	struct FCandidate
+	{
+		int32 TileIndex;
+		float DistanceSquared;
+		uint64 LastUse;
+	};
+	TArray<FCandidate> Candidates;
+	Candidates.Reserve(VirtualTiles.Num());
+	TArray<int32> Kept;
+	for (int32 TileIndex : VirtualTiles)
+	{
+		if (InUse.Contains(TileIndex))
+		{
+			Kept.Add(TileIndex);
+			continue;
+		}
+		const FNavGridTileRecord &Record = TileRecords[TileIndex];
+		float DistanceSquared = MAX_flt;
+		for (const FVector &PawnLocation : PawnLocations)
+		{
+			DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(Record.Location, PawnLocation));
+		}
+		Candidates.Add({ TileIndex, DistanceSquared, Record.LastVirtualTileUse });
+	}
+	Candidates.Sort([](const FCandidate &A, const FCandidate &B)
+	{
+		if (A.DistanceSquared != B.DistanceSquared)
+		{
+			return A.DistanceSquared > B.DistanceSquared;
+		}
+		return A.LastUse < B.LastUse;
+	});
+
+	NumToEvict = FMath::Min(NumToEvict, Candidates.Num());
+	UE_LOG(NavGrid, Log, TEXT("Limit reached (%i), recycling %i virtual tiles"), MaxVirtualTiles, NumToEvict);
+
+	VirtualTiles = MoveTemp(Kept);
+	for (int32 Idx = 0; Idx < Candidates.Num(); Idx++)
+	{
+		if (Idx < NumToEvict)
+		{
+			RecycleVirtualTile(Candidates[Idx].TileIndex);
+		}
+		else
+		{
+			VirtualTiles.Add(Candidates[Idx].TileIndex);
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_NavGrid_EvictedVirtualTiles, NumToEvict);
+	SET_DWORD_STAT(STAT_NavGrid_VirtualTiles, VirtualTiles.Num());
+	SET_DWORD_STAT(STAT_NavGrid_PooledVirtualTiles, VirtualTilePool.Num());
+}
+
+void ANavGrid::RecycleVirtualTile(int32 TileIndex)
+{
+	// the caller has taken the tile out of VirtualTiles already
+	TileRecords[TileIndex].bVirtual = false;
+	UNavTileComponent *Tile = FindTileComponent(TileIndex);
+	if (Tile)
+	{
+		// removes the tile from the grid and makes its neighbours drop their edges to it
+		Tile->UnregisterComponent();
+		VirtualTilePool.Add(Tile);
+	}
+	else
+	{
+		UnregisterTileIndex(TileIndex);
+	}
+}
+
+UNavTileComponent *ANavGrid::TakePooledTile()
+{
+	while (VirtualTilePool.Num())
+	{
+		UNavTileComponent *Tile = VirtualTilePool.Pop(false);
+		if (!IsValid(Tile))
+		{
+			continue;
+		}
+		if (Tile->GetClass() != TileClass)
+		{
+			// TileClass has changed since the tile was pooled
+			Tile->DestroyComponent();
+			continue;
+		}
+		INC_DWORD_STAT(STAT_NavGrid_RecycledVirtualTiles);
+		return Tile;
+	}
+	return nullptr;
+}
+
+#if WITH_EDITOR
+void ANavGrid::BakeVirtualTiles()
+{
+	if (!BakedVirtualTiles)
+	{
+		UE_LOG(NavGrid, Error, TEXT("%s: Set BakedVirtualTiles to a NavGridBakedTiles asset before baking"), *GetName());
+		return;
+	}
+	FBox Bounds = ALevelBounds::CalculateLevelBounds(GetLevel());
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(NavGrid, Error, TEXT("%s: Unable to find the bounds of the level"), *GetName());
+		return;
+	}
+
+	UNavGridBakedTiles &Baked = *BakedVirtualTiles;
+	Baked.Modify();
+	Baked.Empty();
+	Baked.Bounds = Bounds;
+	Baked.TileSize = TileSize;
+
+	// tile centers line up with the grid actor, see AdjustToTileLocation()
+	const FVector Origin = GetActorLocation() + FVector(TileSize / 2, TileSize / 2, 0);
+	const FIntPoint MinColumn(FMath::FloorToInt((Bounds.Min.X - Origin.X) / TileSize), FMath::FloorToInt((Bounds.Min.Y - Origin.Y) / TileSize));
+	const FIntPoint MaxColumn(FMath::CeilToInt((Bounds.Max.X - Origin.X) / TileSize), FMath::CeilToInt((Bounds.Max.Y - Origin.Y) / TileSize));
+	const int32 NumZSteps = FMath::CeilToInt(Bounds.GetSize().Z / TileSize) + 1;
+	const FCollisionShape TileShape = FCollisionShape::MakeBox(FVector(TileSize / 3, TileSize / 3, 25));
+	auto HitsTile = [](const FHitResult &Hit) { return IsValid(Cast<UNavTileComponent>(Hit.GetComponent())); };
+
+	FScopedSlowTask SlowTask(2, NSLOCTEXT("NavGrid", "BakeVirtualTiles", "Baking virtual tiles"));
+	SlowTask.MakeDialog();
+
+	// find tile locations the same way ConsiderPlaceTile() does
+	TMap<FIntPoint, TArray<int32>> Columns;
+	TArray<FIntPoint> TileColumns;
+	for (int32 X = MinColumn.X; X <= MaxColumn.X; X++)
+	{
+		SlowTask.EnterProgressFrame(1.0f / (MaxColumn.X - MinColumn.X + 1));
+		for (int32 Y = MinColumn.Y; Y <= MaxColumn.Y; Y++)
+		{
+			const FIntPoint ColumnKey(X, Y);
+			const FVector Column = Origin + FVector(X, Y, 0) * TileSize;
+			for (int32 ZStep = 0; ZStep < NumZSteps; ZStep++)
+			{
+				const float Z = Bounds.Max.Z - ZStep * TileSize;
+				FVector TileLocation;
+				if (!TraceTileLocation(FVector(Column.X, Column.Y, Z + TileSize), FVector(Column.X, Column.Y, Z - 0.1), TileLocation))
+				{
+					continue;
+				}
+
+				// skip locations covered by tiles placed in the level, or by tiles found further up this column
+				TArray<FHitResult> HitResults;
+				GetWorld()->SweepMultiByChannel(HitResults, TileLocation, TileLocation - FVector(0, 0, 1), FQuat::Identity, ECC_NavGridWalkable, TileShape);
+				TArray<int32> &ColumnTiles = Columns.FindOrAdd(ColumnKey);
+				if (HitResults.ContainsByPredicate(HitsTile) ||
+					ColumnTiles.ContainsByPredicate([&Baked, &TileLocation](int32 Idx) { return FMath::Abs(Baked.Locations[Idx].Z - TileLocation.Z) < 50; }))
+				{
+					continue;
+				}
+				ColumnTiles.Add(Baked.Locations.Add(TileLocation));
+				Baked.Extents.Add(FVector(TileSize / 2, TileSize / 2, 5));
+				TileColumns.Add(ColumnKey);
+			}
+		}
+	}
+
+	// capsules to bake obstructions for, see BakeNeighbourGraph()
+	TArray<const UCapsuleComponent *> Capsules;
+	for (TActorIterator<AGridPawn> Itr(GetWorld()); Itr; ++Itr)
+	{
+		const UCapsuleComponent *Capsule = Itr->MovementCollisionCapsule;
+		if (IsValid(Capsule) && Capsules.Num() < 32 &&
+			!Baked.CapsuleProfiles.ContainsByPredicate([Capsule](const FNavGridCapsuleProfile &P) { return P.Matches(*Capsule); }))
+		{
+			FNavGridCapsuleProfile &Profile = Baked.CapsuleProfiles.AddDefaulted_GetRef();
+			Profile.Radius = Capsule->GetScaledCapsuleRadius();
+			Profile.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+			Profile.Offset = Capsule->GetRelativeLocation();
+			Capsules.Add(Capsule);
+		}
+	}
+
+	// find neighbours the same way UNavTileComponent::GetNeighbours() does
+	const int32 NumTiles = Baked.Num();
+	const UNavTileComponent *TileDefaults = TileClass->GetDefaultObject<UNavTileComponent>();
+	Baked.BorderTiles.Init(false, NumTiles);
+	Baked.EdgeOffsets.Reserve(NumTiles + 1);
+	const float TileProgress = NumTiles > 0 ? 1.0f / NumTiles : 0.0f;
+	for (int32 Idx = 0; Idx < NumTiles; Idx++)
+	{
+		SlowTask.EnterProgressFrame(TileProgress);
+		Baked.EdgeOffsets.Add(Baked.EdgeTargets.Num());
+		const FVector &Location = Baked.Locations[Idx];
+		const FVector ReachExtent = Baked.Extents[Idx] + FVector(TileSize * 0.75);
+		for (int32 DX = -1; DX <= 1; DX++)
+		{
+			for (int32 DY = -1; DY <= 1; DY++)
+			{
+				const TArray<int32> *ColumnTiles = Columns.Find(TileColumns[Idx] + FIntPoint(DX, DY));
+				if (!ColumnTiles)
+				{
+					continue;
+				}
+				for (int32 NIdx : *ColumnTiles)
+				{
+					const FVector Delta = (Baked.Locations[NIdx] - Location).GetAbs();
+					const FVector MaxDelta = ReachExtent + Baked.Extents[NIdx];
+					if (NIdx == Idx || Delta.X > MaxDelta.X || Delta.Y > MaxDelta.Y || Delta.Z > MaxDelta.Z)
+					{
+						continue;
+					}
+
+					uint32 ObstructedProfiles = 0;
+					for (int32 Profile = 0; Profile < Capsules.Num(); Profile++)
+					{
+						const FVector CapsuleOffset = Capsules[Profile]->GetRelativeLocation();
+						if (TileDefaults->Obstructed(Location + CapsuleOffset, Baked.Locations[NIdx] + CapsuleOffset, *Capsules[Profile], GetBakeResponseParams()))
+						{
+							ObstructedProfiles |= 1u << Profile;
+						}
+					}
+					Baked.EdgeTargets.Add(NIdx);
+					Baked.EdgeObstructedProfiles.Add(ObstructedProfiles);
+				}
+			}
+		}
+
+		// tiles near the edge of the baked area or near tiles placed in the level may have neighbours that we do not know about
+		const FBox Reach(Location - ReachExtent, Location + ReachExtent);
+		TArray<FHitResult> HitResults;
+		GetWorld()->SweepMultiByChannel(HitResults, Location, Location + FVector(0, 0, 1), FQuat::Identity, ECC_NavGridWalkable, FCollisionShape::MakeBox(ReachExtent));
+		Baked.BorderTiles[Idx] = !Bounds.IsInside(Reach) || HitResults.ContainsByPredicate(HitsTile);
+	}
+	Baked.EdgeOffsets.Add(Baked.EdgeTargets.Num());
+
+	Baked.MarkPackageDirty();
+	UE_LOG(NavGrid, Log, TEXT("%s: Baked %i virtual tiles with %i edges"), *GetName(), NumTiles, Baked.EdgeTargets.Num());
+}
+#endif // WITH_EDITOR
+
+void ANavGrid::PlaceBakedTiles()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ANavGrid_PlaceBakedTiles);
+
+	if (!BakedVirtualTiles || bPlacedBakedTiles)
+	{
+		return;
+	}
+	const UNavGridBakedTiles &Baked = *BakedVirtualTiles;
+	if (Baked.TileSize != TileSize)
+	{
+		UE_LOG(NavGrid, Warning, TEXT("%s: %s was baked with a TileSize of %f, ignoring it"), *GetName(), *Baked.GetName(), Baked.TileSize);
+		return;
+	}
+
+	// the asset has its own set of capsule profiles
+	TArray<int32> ProfileMap;
+	uint32 KnownProfiles = 0;
+	for (const FNavGridCapsuleProfile &BakedProfile : Baked.CapsuleProfiles)
+	{
+		int32 Profile = FindOrAddCapsuleProfile(BakedProfile);
+		ProfileMap.Add(Profile);
+		if (Profile != INDEX_NONE)
+		{
+			KnownProfiles |= 1u << Profile;
+		}
+	}
+
+	BakedTiles.Reserve(Baked.Num());
+	for (int32 Idx = 0; Idx < Baked.Num(); Idx++)
+	{
+		BakedTiles.Add(AddTileRecord(Baked.Locations[Idx], Baked.Extents[Idx]));
+	}
+
+	// border tiles get their edges baked the usual way, as they may have neighbours that are not in the asset
+	for (int32 Idx = 0; Idx < Baked.Num(); Idx++)
+	{
+		if (Baked.BorderTiles[Idx])
+		{
+			continue;
+		}
+		FNavGridTileRecord &Record = TileRecords[BakedTiles[Idx]];
+		Record.Edges.Reset();
+		for (int32 EdgeIdx = Baked.EdgeOffsets[Idx]; EdgeIdx < Baked.EdgeOffsets[Idx + 1]; EdgeIdx++)
+		{
+			FNavTileEdge &Edge = Record.Edges.AddDefaulted_GetRef();
+			Edge.TileIndex = BakedTiles[Baked.EdgeTargets[EdgeIdx]];
+			Edge.ObstructedProfiles = ~0u;
+			for (int32 BakedProfile = 0; BakedProfile < ProfileMap.Num(); BakedProfile++)
+			{
+				if (ProfileMap[BakedProfile] != INDEX_NONE && !(Baked.EdgeObstructedProfiles[EdgeIdx] & (1u << BakedProfile)))
+				{
+					Edge.ObstructedProfiles &= ~(1u << ProfileMap[BakedProfile]);
+				}
+			}
+			FVector Delta = TileRecords[Edge.TileIndex].Location - Record.Location;
+			MaxEdgeLength = FMath::Max3(MaxEdgeLength, FMath::Abs(Delta.X), FMath::Abs(Delta.Y));
+		}
+		Record.BakedProfiles = KnownProfiles;
+	}
+	bPlacedBakedTiles = true;
+}
+
+bool ANavGrid::IsInBakedArea(const FVector &Location) const
+{
+	return bPlacedBakedTiles && BakedVirtualTiles && BakedVirtualTiles->Bounds.IsInside(Location);
 }
 
 void ANavGrid::Destroyed()
 {
 	Super::Destroyed();
+	for (auto &Pair : PendingQueries)
+	{
+		*Pair.Value.bCancelled = true;
+	}
+	PendingQueries.Empty();
+	CancelVirtualTileJob();
 	DestroyVirtualTiles();
 }
 
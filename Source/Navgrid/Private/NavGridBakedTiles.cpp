@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridBakedTiles.h"
+#include "NavGridPrivatePCH.h"
+#include "Serialization/CustomVersion.h"
+
+/* Version of the data written by UNavGridBakedTiles::Serialize(). Add a new entry whenever that changes */
+struct FNavGridBakedTilesVersion
+{
+	enum Type
+	{
+		/* Assets saved before the version was recorded use the same layout */
+		Initial = 0,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+	static const FGuid GUID;
+};
+
+const FGuid FNavGridBakedTilesVersion::GUID(0x680AE353, 0x138C4E71, 0xBD177506, 0xAB31CB2B);
+static FCustomVersionRegistration GRegisterNavGridBakedTilesVersion(FNavGridBakedTilesVersion::GUID, FNavGridBakedTilesVersion::LatestVersion, TEXT("NavGridBakedTiles"));
+
+void UNavGridBakedTiles::Serialize(FArchive &Ar)
+{
+	Super::Serialize(Ar);
+	Ar.UsingCustomVersion(FNavGridBakedTilesVersion::GUID);
+
+	Locations.BulkSerialize(Ar);
+	Extents.BulkSerialize(Ar);
+	Ar << BorderTiles;
+	EdgeOffsets.BulkSerialize(Ar);
+	EdgeTargets.BulkSerialize(Ar);
+	EdgeObstructedProfiles.BulkSerialize(Ar);
+}
+
+void UNavGridBakedTiles::Empty()
+{
+	Bounds = FBox(ForceInit);
+	TileSize = 0;
+	CapsuleProfiles.Empty();
+	Locations.Empty();
+	Extents.Empty();
+	BorderTiles.Empty();
+	EdgeOffsets.Empty();
+	EdgeTargets.Empty();
+	EdgeObstructedProfiles.Empty();
+}
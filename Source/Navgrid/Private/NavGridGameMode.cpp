@@ -3,6 +3,8 @@
 #include "NavGridGameMode.h"
 #include "NavGridPrivatePCH.h"
 
+#include "Misc/FileHelper.h"
+
 ANavGridGameMode::ANavGridGameMode()
 	:Super()
 {
@@ -18,4 +20,131 @@ void ANavGridGameMode::BeginPlay()
 	//GetWorld()->DebugDrawTraceTag = "NavGridMovement";
 	//GetWorld()->DebugDrawTraceTag = "NavGridTile";
 	//GetWorld()->DebugDrawTraceTag = "NavGridTilePlacement";
+
+	int32 MaxTurns = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("NavGridSimulate="), MaxTurns))
+	{
+		int32 Seed = 0;
+		FParse::Value(FCommandLine::Get(), TEXT("NavGridSeed="), Seed);
+		FParse::Value(FCommandLine::Get(), TEXT("NavGridSimulationLog="), SimulationLogFile);
+		bExitAfterSimulation = true;
+		StartSimulation(MaxTurns, Seed);
+	}
+}
+
+void ANavGridGameMode::StartSimulation(int32 MaxTurns, int32 Seed)
+{
+	ANavGridGameState *State = GetGameState<ANavGridGameState>();
+	if (!State || bSimulating)
+	{
+		return;
+	}
+
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+	for (TActorIterator<AGridPawn> Itr(GetWorld()); Itr; ++Itr)
+	{
+		ApplySimulationSettings(**Itr);
+	}
+	// range results must not depend on how many virtual tiles fit in a frame
+	SavedVirtualTileBudgets.Reset();
+	for (TActorIterator<ANavGrid> Itr(GetWorld()); Itr; ++Itr)
+	{
+		SavedVirtualTileBudgets.Add(*Itr, Itr->VirtualTileBudgetMicroseconds);
+		Itr->VirtualTileBudgetMicroseconds = 0;
+		Itr->CompleteVirtualTileJob();
+	}
+
+	ATurnManager *TurnManager = State->GetTurnManager();
+	TurnManager->bSimulate = true;
+	TurnManager->OnTurnEnd().AddDynamic(this, &ANavGridGameMode::OnSimulatedTurnEnd);
+	// whoever has the turn may be waiting for a human player
+	if (IsValid(TurnManager->GetCurrentComponent()))
+	{
+		TurnManager->EndTurn(TurnManager->GetCurrentComponent());
+	}
+
+	bSimulating = true;
+	MaxSimulatedTurns = MaxTurns;
+	NumSimulatedTurns = 0;
+	SimulationLog.Reset();
+	SimulationStartTime = FPlatformTime::Seconds();
+	UE_LOG(NavGrid, Log, TEXT("Simulating up to %i turns with seed %i"), MaxTurns, Seed);
+	// wait for every pawn to begin play and register with the turn manager
+	GetWorldTimerManager().SetTimerForNextTick(this, &ANavGridGameMode::StepSimulation);
+}
+
+void ANavGridGameMode::ApplySimulationSettings(AGridPawn &Pawn) const
+{
+	Pawn.bHumanControlled = false;
+	Pawn.MovementComponent->bInstantMovement = true;
+}
+
+void ANavGridGameMode::StepSimulation()
+{
+	ATurnManager *TurnManager = GetGameState<ANavGridGameState>()->GetTurnManager();
+	NumSimulatedTurns += TurnManager->SimulateTurns(MaxSimulatedTurns - NumSimulatedTurns);
+
+	if (NumSimulatedTurns >= MaxSimulatedTurns || TurnManager->GetNumTeams() < 2)
+	{
+		FinishSimulation();
+	}
+	else
+	{
+		// the AI has not ended its turn yet, e.g. because it is waiting for a timer
+		GetWorldTimerManager().SetTimerForNextTick(this, &ANavGridGameMode::StepSimulation);
+	}
+}
+
+void ANavGridGameMode::FinishSimulation()
+{
+	ATurnManager *TurnManager = GetGameState<ANavGridGameState>()->GetTurnManager();
+	TurnManager->OnTurnEnd().RemoveDynamic(this, &ANavGridGameMode::OnSimulatedTurnEnd);
+	TurnManager->bSimulate = false;
+	bSimulating = false;
+	for (const TPair<TWeakObjectPtr<ANavGrid>, float> &Saved : SavedVirtualTileBudgets)
+	{
+		if (Saved.Key.IsValid())
+		{
+			Saved.Key->VirtualTileBudgetMicroseconds = Saved.Value;
+		}
+	}
+	SavedVirtualTileBudgets.Empty();
+	// nothing would start a turn that was requested during the last step
+	if (TurnManager->IsTurnPending())
+	{
+		TurnManager->SimulateTurns(1);
+	}
+
+	double Seconds = FPlatformTime::Seconds() - SimulationStartTime;
+	UE_LOG(NavGrid, Log, TEXT("Simulation done: %i turns, %i rounds, %i teams left, %.3f sec (%.0f turns/sec)"),
+		NumSimulatedTurns, TurnManager->GetRound(), TurnManager->GetNumTeams(), Seconds, NumSimulatedTurns / FMath::Max(Seconds, 1e-6));
+
+	if (!SimulationLogFile.IsEmpty())
+	{
+		SimulationLog += FString::Printf(TEXT("# turns=%i rounds=%i teams=%i\n"), NumSimulatedTurns, TurnManager->GetRound(), TurnManager->GetNumTeams());
+		if (!FFileHelper::SaveStringToFile(SimulationLog, *SimulationLogFile))
+		{
+			UE_LOG(NavGrid, Error, TEXT("Unable to write simulation log to %s"), *SimulationLogFile);
+		}
+	}
+	SimulationLog.Empty();
+
+	if (bExitAfterSimulation)
+	{
+		FGenericPlatformMisc::RequestExit(false);
+	}
+}
+
+void ANavGridGameMode::OnSimulatedTurnEnd(UTurnComponent *TurnComponent)
+{
+	if (SimulationLogFile.IsEmpty() || !IsValid(TurnComponent))
+	{
+		return;
+	}
+
+	AGridPawn *Pawn = Cast<AGridPawn>(TurnComponent->GetOwner());
+	UNavTileComponent *Tile = Pawn ? Pawn->GetTile() : nullptr;
+	SimulationLog += FString::Printf(TEXT("%i,%i,%s,%i\n"), TurnComponent->GetTurnManager()->GetRound(), TurnComponent->TeamId().GetId(),
+		*TurnComponent->GetOwner()->GetName(), Tile ? Tile->TileIndex : INDEX_NONE);
 }
@@ -2,32 +2,20 @@
 
 #include "NavGridGameState.h"
 #include "NavGridPrivatePCH.h"
+#include "NavGridSubsystem.h"
 
 ANavGrid* ANavGridGameState::GetNavGrid()
 {
 	if (!IsValid(Grid))
 	{
 		// if a navgrid exists in the game world, grab it
-		TActorIterator<ANavGrid> GridItr(GetWorld());
-		if (GridItr)
-		{
-			Grid = *GridItr;
-		}
-		else
+		UNavGridSubsystem *Subsystem = GetWorld()->GetSubsystem<UNavGridSubsystem>();
+		Grid = Subsystem ? Subsystem->GetGrid() : nullptr;
+		if (!Grid)
 		{
+			// tiles without a grid are picked up by ANavGrid::PostRegisterAllComponents()
 			Grid = SpawnNavGrid();
 		}
-
-		// make sure that every tile belongs to a grid
-		TArray<UNavTileComponent*> AllTiles;
-		Grid->GetEveryTile(AllTiles, GetWorld());
-		for (UNavTileComponent* Tile : AllTiles)
-		{
-			if (!Tile->GetGrid())
-			{
-				Tile->SetGrid(Grid);
-			}
-		}
 	}
 	return Grid;
 }
@@ -0,0 +1,499 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridHierarchy.h"
+#include "NavGridPrivatePCH.h"
+
+#include <limits>
+
+namespace
+{
+	/* Cluster of tiles that are not registered */
+	const FIntVector NoCluster(MAX_int32, MAX_int32, MAX_int32);
+	/* Rebaking edges while rebuilding may dirty more clusters, give up on converging after this many passes */
+	const int32 MaxRebuildPasses = 8;
+}
+
+FNavGridHierarchy::FNavGridHierarchy(ANavGrid &InGrid, int32 InProfile, const FGridMovementModes &InMovementModes)
+	: Grid(InGrid), Profile(InProfile), MovementModes(InMovementModes)
+{
+	ClusterExtent = Grid.ClusterSize * Grid.TileSize;
+	ClusterHeight = Grid.ClusterHeight;
+	for (int32 Idx = 0; Idx < Grid.GetNumTileIndices(); Idx++)
+	{
+		UpdateTile(Idx);
+	}
+}
+
+bool FNavGridHierarchy::Matches(int32 InProfile, const FGridMovementModes &InMovementModes) const
+{
+	return Profile == InProfile && MovementModes == InMovementModes;
+}
+
+bool FNavGridHierarchy::HasCurrentClusterSettings() const
+{
+	return ClusterExtent == Grid.ClusterSize * Grid.TileSize && ClusterHeight == Grid.ClusterHeight;
+}
+
+FIntVector FNavGridHierarchy::GetClusterKey(const FVector &Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / ClusterExtent),
+		FMath::FloorToInt(Location.Y / ClusterExtent),
+		FMath::FloorToInt(Location.Z / ClusterHeight));
+}
+
+bool FNavGridHierarchy::InSameCluster(int32 TileIndexA, int32 TileIndexB) const
+{
+	return GetTileCluster(TileIndexA) == GetTileCluster(TileIndexB);
+}
+
+const FIntVector &FNavGridHierarchy::GetTileCluster(int32 TileIndex) const
+{
+	return TileClusters.IsValidIndex(TileIndex) ? TileClusters[TileIndex] : NoCluster;
+}
+
+void FNavGridHierarchy::UpdateTile(int32 TileIndex)
+{
+	if (TileIndex == INDEX_NONE)
+	{
+		return;
+	}
+	FIntVector NewKey = Grid.IsValidTileIndex(TileIndex) ? GetClusterKey(Grid.GetTileRecord(TileIndex).Location) : NoCluster;
+	while (TileClusters.Num() <= TileIndex)
+	{
+		TileClusters.Add(NoCluster);
+	}
+
+	FIntVector &Key = TileClusters[TileIndex];
+	if (Key == NewKey)
+	{
+		return;
+	}
+	if (Key != NoCluster)
+	{
+		Clusters.FindChecked(Key).Tiles.RemoveSingleSwap(TileIndex, false);
+		DirtyClusters.Add(Key);
+	}
+	if (NewKey != NoCluster)
+	{
+		Clusters.FindOrAdd(NewKey).Tiles.Add(TileIndex);
+		DirtyClusters.Add(NewKey);
+	}
+	Key = NewKey;
+}
+
+void FNavGridHierarchy::MarkDirty(int32 TileIndex)
+{
+	const FIntVector &Key = GetTileCluster(TileIndex);
+	if (Key != NoCluster)
+	{
+		DirtyClusters.Add(Key);
+	}
+}
+
+int32 FNavGridHierarchy::GetNumNodes() const
+{
+	int32 NumNodes = 0;
+	for (const auto &Pair : Clusters)
+	{
+		NumNodes += Pair.Value.NodeEdges.Num();
+	}
+	return NumNodes;
+}
+
+void FNavGridHierarchy::Rebuild(const UCapsuleComponent &Capsule)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FNavGridHierarchy_Rebuild);
+
+	for (int32 Pass = 0; Pass < MaxRebuildPasses && DirtyClusters.Num(); Pass++)
+	{
+		TSet<FIntVector> Dirty = MoveTemp(DirtyClusters);
+		DirtyClusters.Reset();
+
+		// clusters that gain or lose nodes need their edges rebuilt as well
+		TSet<FIntVector> Touched = Dirty;
+		for (const FIntVector &Key : Dirty)
+		{
+			// old neighbours may have lost their connection to this cluster, new ones may have gained one
+			const FCluster *Cluster = Clusters.Find(Key);
+			TSet<FIntVector> Neighbours = Cluster ? Cluster->Incoming.Union(Cluster->Outgoing) : TSet<FIntVector>();
+			RebuildPortals(Key, nullptr, Capsule, Touched);
+			if (Cluster)
+			{
+				Neighbours.Append(Cluster->Outgoing);
+			}
+			for (const FIntVector &Neighbour : Neighbours)
+			{
+				RebuildPortals(Neighbour, &Key, Capsule, Touched);
+			}
+		}
+
+		for (const FIntVector &Key : Touched)
+		{
+			FCluster *Cluster = Clusters.Find(Key);
+			if (Cluster && !Cluster->Tiles.Num() && !Cluster->Outgoing.Num() && !Cluster->Incoming.Num())
+			{
+				Clusters.Remove(Key);
+			}
+			else if (Cluster)
+			{
+				RebuildNodeEdges(Key, Capsule);
+			}
+		}
+	}
+
+	if (DirtyClusters.Num())
+	{
+		UE_LOG(NavGrid, Warning, TEXT("Hierarchical graph did not settle after %i passes, %i clusters are still dirty"), MaxRebuildPasses, DirtyClusters.Num());
+	}
+}
+
+void FNavGridHierarchy::RebuildPortals(const FIntVector &FromKey, const FIntVector *OnlyTo, const UCapsuleComponent &Capsule, TSet<FIntVector> &OutTouched)
+{
+	FCluster *From = Clusters.Find(FromKey);
+	if (!From)
+	{
+		return;
+	}
+
+	// throw away the old portals
+	TArray<FIntVector> OldNeighbours = OnlyTo ? TArray<FIntVector>({ *OnlyTo }) : From->Outgoing.Array();
+	for (const FIntVector &ToKey : OldNeighbours)
+	{
+		Portals.Remove(FBoundaryKey(FromKey, ToKey));
+		From->Outgoing.Remove(ToKey);
+		FCluster *To = Clusters.Find(ToKey);
+		if (To)
+		{
+			To->Incoming.Remove(FromKey);
+		}
+		OutTouched.Add(ToKey);
+	}
+
+	// find every edge that leaves the cluster, grouped by the cluster it enters
+	TMap<FIntVector, TArray<TPair<int32, int32>>> Crossings;
+	TArray<int32> Neighbours;
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(MovementModes.Mask);
+	for (int32 TileIndex : From->Tiles)
+	{
+		Grid.GetBakedNeighbours(TileIndex, Capsule, Profile, Neighbours);
+		for (int32 NIndex : Neighbours)
+		{
+			const FIntVector &ToKey = GetTileCluster(NIndex);
+			if (ToKey != NoCluster && ToKey != FromKey && (!OnlyTo || ToKey == *OnlyTo) &&
+				(Grid.GetTileRecord(NIndex).TraversableMasks & TraversableBit))
+			{
+				Crossings.FindOrAdd(ToKey).Add(TPair<int32, int32>(TileIndex, NIndex));
+			}
+		}
+	}
+
+	for (auto &Pair : Crossings)
+	{
+		const FIntVector &ToKey = Pair.Key;
+		TArray<FPortal> &NewPortals = Portals.Add(FBoundaryKey(FromKey, ToKey));
+
+		// ladders always get a portal of their own
+		TMap<int32, int32> BorderTiles;
+		for (const TPair<int32, int32> &Crossing : Pair.Value)
+		{
+			// virtual and baked tiles are never ladders, and may not have a component
+			const UNavTileComponent *FromTile = Grid.FindTileComponent(Crossing.Key);
+			const UNavTileComponent *ToTile = Grid.FindTileComponent(Crossing.Value);
+			if ((FromTile && FromTile->IsA<UNavLadderComponent>()) || (ToTile && ToTile->IsA<UNavLadderComponent>()))
+			{
+				NewPortals.Add(FPortal(Crossing.Key, Crossing.Value, Grid.GetTileRecord(Crossing.Value).Cost));
+			}
+			else if (!BorderTiles.Contains(Crossing.Key))
+			{
+				BorderTiles.Add(Crossing.Key, Crossing.Value);
+			}
+		}
+
+		// one portal for every connected run of border tiles, placed as close to the middle of the run as possible
+		TSet<int32> Unvisited;
+		for (const auto &Border : BorderTiles)
+		{
+			Unvisited.Add(Border.Key);
+		}
+		while (Unvisited.Num())
+		{
+			TArray<int32> Run;
+			TArray<int32> Stack({ *Unvisited.CreateIterator() });
+			Unvisited.Remove(Stack[0]);
+			FVector Centroid = FVector::ZeroVector;
+			while (Stack.Num())
+			{
+				int32 Current = Stack.Pop(false);
+				Run.Add(Current);
+				Centroid += Grid.GetTileRecord(Current).Location;
+				Grid.GetBakedNeighbours(Current, Capsule, Profile, Neighbours);
+				for (int32 NIndex : Neighbours)
+				{
+					if (Unvisited.Remove(NIndex))
+					{
+						Stack.Add(NIndex);
+					}
+				}
+			}
+			Centroid /= Run.Num();
+
+			int32 Best = Run[0];
+			float BestDistance = std::numeric_limits<float>::infinity();
+			for (int32 Candidate : Run)
+			{
+				float Distance = FVector::DistSquared(Grid.GetTileRecord(Candidate).Location, Centroid);
+				if (Distance < BestDistance)
+				{
+					BestDistance = Distance;
+					Best = Candidate;
+				}
+			}
+			int32 Entered = BorderTiles[Best];
+			NewPortals.Add(FPortal(Best, Entered, Grid.GetTileRecord(Entered).Cost));
+		}
+
+		From->Outgoing.Add(ToKey);
+		FCluster *To = Clusters.Find(ToKey);
+		if (To)
+		{
+			To->Incoming.Add(FromKey);
+		}
+		OutTouched.Add(ToKey);
+	}
+}
+
+void FNavGridHierarchy::RebuildNodeEdges(const FIntVector &Key, const UCapsuleComponent &Capsule)
+{
+	FCluster &Cluster = Clusters.FindChecked(Key);
+	TArray<int32> Nodes;
+	TMap<int32, TArray<FEdge>> PortalEdges;
+	for (const FIntVector &ToKey : Cluster.Outgoing)
+	{
+		for (const FPortal &Portal : Portals.FindChecked(FBoundaryKey(Key, ToKey)))
+		{
+			Nodes.AddUnique(Portal.From);
+			PortalEdges.FindOrAdd(Portal.From).Add(FEdge(Portal.To, Portal.Cost));
+		}
+	}
+	for (const FIntVector &FromKey : Cluster.Incoming)
+	{
+		for (const FPortal &Portal : Portals.FindChecked(FBoundaryKey(FromKey, Key)))
+		{
+			Nodes.AddUnique(Portal.To);
+		}
+	}
+
+	Cluster.NodeEdges.Reset();
+	for (int32 Node : Nodes)
+	{
+		SearchCluster(Key, Node, INDEX_NONE, Capsule, ClusterContext);
+		TArray<FEdge> &Edges = Cluster.NodeEdges.Add(Node);
+		for (int32 Other : Nodes)
+		{
+			float Distance = ClusterContext.GetDistance(Other);
+			if (Other != Node && Distance < std::numeric_limits<float>::infinity())
+			{
+				Edges.Add(FEdge(Other, Distance));
+			}
+		}
+		if (PortalEdges.Contains(Node))
+		{
+			Edges.Append(PortalEdges[Node]);
+		}
+	}
+}
+
+bool FNavGridHierarchy::SearchCluster(const FIntVector &Key, int32 From, int32 To, const UCapsuleComponent &Capsule, FNavGridSearchContext &Context)
+{
+	Context.Reset(Grid.GetNumTileIndices());
+	const bool bHasTarget = Grid.IsValidTileIndex(To);
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(MovementModes.Mask);
+	TArray<int32> Neighbours;
+	if (bHasTarget)
+	{
+		Grid.UpdateHeuristicBounds();
+	}
+
+	Context.SetDistance(From, 0, INDEX_NONE);
+	Context.OpenSet.Push(From, 0);
+	while (!Context.OpenSet.IsEmpty())
+	{
+		int32 CurrentIndex = Context.OpenSet.Pop();
+		if (CurrentIndex == To)
+		{
+			return true;
+		}
+		float CurrentDistance = Context.GetDistance(CurrentIndex);
+		Context.SetVisited(CurrentIndex);
+		Context.NumExpanded++;
+
+		Grid.GetBakedNeighbours(CurrentIndex, Capsule, Profile, Neighbours);
+		for (int32 NIndex : Neighbours)
+		{
+			if (GetTileCluster(NIndex) != Key || Context.IsVisited(NIndex))
+			{
+				continue;
+			}
+			const FNavGridTileRecord &Record = Grid.GetTileRecord(NIndex);
+			if (!(Record.TraversableMasks & TraversableBit))
+			{
+				continue;
+			}
+
+			float TentativeDistance = CurrentDistance + Record.Cost;
+			if (TentativeDistance < Context.GetDistance(NIndex))
+			{
+				Context.SetDistance(NIndex, TentativeDistance, CurrentIndex);
+				Context.OpenSet.Push(NIndex, TentativeDistance + (bHasTarget ? Grid.EstimateCost(NIndex, To) : 0));
+			}
+		}
+	}
+
+	return To == INDEX_NONE;
+}
+
+bool FNavGridHierarchy::FindPath(int32 StartIndex, int32 TargetIndex, const UCapsuleComponent &Capsule, FNavGridSearchContext &Context, TArray<int32> &OutPath)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FNavGridHierarchy_FindPath);
+
+	OutPath.Reset();
+	Rebuild(Capsule);
+	// take the bounds after Rebuild(), which may have baked longer edges
+	Grid.UpdateHeuristicBounds();
+
+	const FIntVector StartKey = GetTileCluster(StartIndex);
+	const FIntVector TargetKey = GetTileCluster(TargetIndex);
+	const FCluster *StartCluster = Clusters.Find(StartKey);
+	const FCluster *TargetCluster = Clusters.Find(TargetKey);
+	if (!StartCluster || !TargetCluster || !Grid.IsValidTileIndex(TargetIndex))
+	{
+		return false;
+	}
+	if (StartIndex == TargetIndex)
+	{
+		OutPath.Add(StartIndex);
+		return true;
+	}
+
+	// within a single cluster the path does not need the abstract graph, unless it has to leave the cluster
+	if (StartKey == TargetKey && SearchCluster(StartKey, StartIndex, TargetIndex, Capsule, ClusterContext))
+	{
+		for (int32 Index = TargetIndex; Index != INDEX_NONE; Index = ClusterContext.GetBackpointer(Index))
+		{
+			OutPath.Add(Index);
+		}
+		Algo::Reverse(OutPath);
+		return true;
+	}
+
+	// temporarily connect the start and target tiles to the nodes of their clusters
+	TArray<FEdge> StartEdges;
+	SearchCluster(StartKey, StartIndex, INDEX_NONE, Capsule, ClusterContext);
+	for (const auto &Pair : StartCluster->NodeEdges)
+	{
+		float Distance = ClusterContext.GetDistance(Pair.Key);
+		if (Pair.Key != StartIndex && Distance < std::numeric_limits<float>::infinity())
+		{
+			StartEdges.Add(FEdge(Pair.Key, Distance));
+		}
+	}
+	if (StartKey == TargetKey && ClusterContext.GetDistance(TargetIndex) < std::numeric_limits<float>::infinity())
+	{
+		StartEdges.Add(FEdge(TargetIndex, ClusterContext.GetDistance(TargetIndex)));
+	}
+	TMap<int32, float> TargetCosts;
+	for (const auto &Pair : TargetCluster->NodeEdges)
+	{
+		if (SearchCluster(TargetKey, Pair.Key, TargetIndex, Capsule, ClusterContext))
+		{
+			TargetCosts.Add(Pair.Key, ClusterContext.GetDistance(TargetIndex));
+		}
+	}
+
+	// A* on the abstract graph
+	Context.Reset(Grid.GetNumTileIndices());
+	auto Relax = [&](int32 From, const FEdge &Edge)
+	{
+		float TentativeDistance = Context.GetDistance(From) + Edge.Cost;
+		if (!Context.IsVisited(Edge.To) && TentativeDistance < Context.GetDistance(Edge.To))
+		{
+			Context.SetDistance(Edge.To, TentativeDistance, From);
+			Context.OpenSet.Push(Edge.To, TentativeDistance + Grid.EstimateCost(Edge.To, TargetIndex));
+		}
+	};
+	Context.SetDistance(StartIndex, 0, INDEX_NONE);
+	Context.OpenSet.Push(StartIndex, 0);
+	while (!Context.OpenSet.IsEmpty())
+	{
+		int32 CurrentIndex = Context.OpenSet.Pop();
+		if (CurrentIndex == TargetIndex)
+		{
+			break;
+		}
+		Context.SetVisited(CurrentIndex);
+		Context.NumExpanded++;
+
+		if (CurrentIndex == StartIndex)
+		{
+			for (const FEdge &Edge : StartEdges)
+			{
+				Relax(CurrentIndex, Edge);
+			}
+		}
+		const FCluster *Cluster = Clusters.Find(GetTileCluster(CurrentIndex));
+		const TArray<FEdge> *Edges = Cluster ? Cluster->NodeEdges.Find(CurrentIndex) : nullptr;
+		if (Edges)
+		{
+			for (const FEdge &Edge : *Edges)
+			{
+				Relax(CurrentIndex, Edge);
+			}
+		}
+		const float *TargetCost = TargetCosts.Find(CurrentIndex);
+		if (TargetCost)
+		{
+			Relax(CurrentIndex, FEdge(TargetIndex, *TargetCost));
+		}
+	}
+
+	if (Context.GetBackpointer(TargetIndex) == INDEX_NONE)
+	{
+		return false;
+	}
+	TArray<int32> AbstractPath;
+	for (int32 Index = TargetIndex; Index != INDEX_NONE; Index = Context.GetBackpointer(Index))
+	{
+		AbstractPath.Add(Index);
+	}
+	Algo::Reverse(AbstractPath);
+
+	// refine every step within a cluster, portals lead straight to a neighbouring tile
+	OutPath.Add(StartIndex);
+	TArray<int32> Segment;
+	for (int32 Idx = 1; Idx < AbstractPath.Num(); Idx++)
+	{
+		int32 From = AbstractPath[Idx - 1];
+		int32 To = AbstractPath[Idx];
+		const FIntVector &Key = GetTileCluster(From);
+		if (Key != GetTileCluster(To))
+		{
+			OutPath.Add(To);
+			continue;
+		}
+		if (!SearchCluster(Key, From, To, Capsule, ClusterContext))
+		{
+			OutPath.Reset();
+			return false;
+		}
+		Segment.Reset();
+		for (int32 Index = To; Index != From; Index = ClusterContext.GetBackpointer(Index))
+		{
+			Segment.Add(Index);
+		}
+		Algo::Reverse(Segment);
+		OutPath.Append(Segment);
+	}
+
+	return true;
+}
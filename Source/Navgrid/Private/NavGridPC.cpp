@@ -22,6 +22,18 @@ void ANavGridPC::BeginPlay()
 	SetGrid(State->GetNavGrid());
 }
 
+void ANavGridPC::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	// virtual and baked tiles have no collision until they have a component
+	FHitResult Hit;
+	if (Grid && bEnableMouseOverEvents && GetHitResultUnderCursor(ECC_Visibility, false, Hit) && !Cast<UNavTileComponent>(Hit.Component.Get()))
+	{
+		Grid->GetTile(Hit.ImpactPoint);
+	}
+}
+
 void ANavGridPC::OnTileClicked(const UNavTileComponent *Tile)
 {
 	/* Try to move the current pawn to the clicked tile */
@@ -36,6 +48,7 @@ void ANavGridPC::OnTileClicked(const UNavTileComponent *Tile)
 
 void ANavGridPC::OnTileCursorOver(const UNavTileComponent *Tile)
 {
+	HoveredTile = Tile;
 	/* If the pawn is not moving, try to create a path to the hovered tile and show it */
 	if (GridPawn && GridPawn->GetState() == EGridPawnState::Ready)
 	{
@@ -43,7 +56,18 @@ void ANavGridPC::OnTileCursorOver(const UNavTileComponent *Tile)
 		Grid->Cursor->SetVisibility(true);
 
 		UGridMovementComponent *MovementComponent = GridPawn->MovementComponent;
-		if (GridPawn->CanMoveTo(*Tile))
+		if (bAsyncCursorPaths && !Grid->EnableVirtualTiles)
+		{
+			// the cursor has moved on, we do not care about the previous tile anymore
+			Grid->CancelQuery(CursorQuery);
+			if (MovementComponent->GetTile() != Tile && Tile->LegalPositionAtEndOfTurn(MovementComponent->AvailableMovementModeFlags))
+			{
+				CursorQuery = Grid->FindPathAsync(GridPawn, *Tile, MovementComponent->MovementRange,
+					FOnNavGridQueryDone::CreateUObject(this, &ANavGridPC::OnCursorPathFound));
+			}
+		}
+		// OnVirtualTilesGenerated() shows the path again once the rest of the virtual tiles are placed
+		else if (GridPawn->CanMoveToProvisionally(*Tile))
 		{
 			MovementComponent->CreatePath(*Tile);
 			MovementComponent->ShowPath();
@@ -51,9 +75,25 @@ void ANavGridPC::OnTileCursorOver(const UNavTileComponent *Tile)
 	}
 }
 
+void ANavGridPC::OnCursorPathFound(const FNavGridQueryResult &Result)
+{
+	CursorQuery = FNavGridQueryHandle();
+	if (Result.bSuccess && GridPawn && GridPawn->GetState() == EGridPawnState::Ready)
+	{
+		UGridMovementComponent *MovementComponent = GridPawn->MovementComponent;
+		if (MovementComponent->CreatePathFromTiles(TArray<const UNavTileComponent *>(Result.Tiles)))
+		{
+			MovementComponent->ShowPath();
+		}
+	}
+}
+
 void ANavGridPC::OnEndTileCursorOver(const UNavTileComponent *Tile)
 {
+	HoveredTile = nullptr;
 	Grid->Cursor->SetVisibility(false);
+	Grid->CancelQuery(CursorQuery);
+	CursorQuery = FNavGridQueryHandle();
 	/* Hide the previously shown path */
 	if (GridPawn)
 	{
@@ -62,6 +102,17 @@ void ANavGridPC::OnEndTileCursorOver(const UNavTileComponent *Tile)
 	}
 }
 
+void ANavGridPC::OnVirtualTilesGenerated(const AGridPawn *Pawn)
+{
+	/* The tiles around the pawn may have changed since the path was shown */
+	const UNavTileComponent *Tile = HoveredTile.Get();
+	if (Pawn && Pawn == GridPawn && Tile)
+	{
+		OnEndTileCursorOver(Tile);
+		OnTileCursorOver(Tile);
+	}
+}
+
 void ANavGridPC::OnTurnStart(UTurnComponent *Component)
 {
 	if (Component->GetOwner()->IsA<AGridPawn>())
@@ -103,10 +154,12 @@ void ANavGridPC::SetGrid(ANavGrid * InGrid)
 		Grid->OnTileClicked.RemoveDynamic(this, &ANavGridPC::OnTileClicked);
 		Grid->OnTileCursorOver.RemoveDynamic(this, &ANavGridPC::OnTileCursorOver);
 		Grid->OnEndTileCursorOver.RemoveDynamic(this, &ANavGridPC::OnEndTileCursorOver);
+		Grid->OnVirtualTilesGenerated.RemoveDynamic(this, &ANavGridPC::OnVirtualTilesGenerated);
 	}
 
 	Grid = InGrid;
 	Grid->OnTileClicked.AddDynamic(this, &ANavGridPC::OnTileClicked);
 	Grid->OnTileCursorOver.AddDynamic(this, &ANavGridPC::OnTileCursorOver);
 	Grid->OnEndTileCursorOver.AddDynamic(this, &ANavGridPC::OnEndTileCursorOver);
+	Grid->OnVirtualTilesGenerated.AddDynamic(this, &ANavGridPC::OnVirtualTilesGenerated);
 }
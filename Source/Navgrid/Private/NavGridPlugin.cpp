@@ -1,10 +1,17 @@
 #include "NavGridPlugin.h"
 #include "NavGridPrivatePCH.h"
+#include "UObject/CoreRedirects.h"
 
 
 void NavGridPluginImpl::StartupModule()
 {
 	UE_LOG(NavGrid, Log, TEXT("Starting"));
+
+	// movement modes used to be saved as TSets under these names. Load them into the deprecated properties so PostLoad() can convert them
+	TArray<FCoreRedirect> Redirects;
+	Redirects.Emplace(ECoreRedirectFlags::Type_Property, TEXT("/Script/NavGrid.NavTileComponent.MovementModes"), TEXT("/Script/NavGrid.NavTileComponent.MovementModes_DEPRECATED"));
+	Redirects.Emplace(ECoreRedirectFlags::Type_Property, TEXT("/Script/NavGrid.GridMovementComponent.AvailableMovementModes"), TEXT("/Script/NavGrid.GridMovementComponent.AvailableMovementModes_DEPRECATED"));
+	FCoreRedirects::AddRedirectList(Redirects, TEXT("NavGrid"));
 }
 
 void NavGridPluginImpl::ShutdownModule()
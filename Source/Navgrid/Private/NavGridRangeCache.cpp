@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridRangeCache.h"
+#include "NavGridPrivatePCH.h"
+
+bool FNavGridRangeCache::Restore(const FNavGridRangeCacheKey &Key, uint32 OccupancyHash, int32 NumTileIndices, FNavGridSearchContext &OutContext, TArray<int32> &OutTiles)
+{
+	FEntry *Entry = Entries.Find(Key);
+	if (!Entry)
+	{
+		return false;
+	}
+	if (Entry->OccupancyHash != OccupancyHash)
+	{
+		// someone has moved since this was stored
+		Remove(Key);
+		return false;
+	}
+
+	Entry->LastUsed = ++UseCounter;
+	OutContext.Reset(NumTileIndices);
+	OutTiles.Reset(Entry->Tiles.Num() - 1);
+	for (int32 Idx = 0; Idx < Entry->Tiles.Num(); Idx++)
+	{
+		OutContext.SetDistance(Entry->Tiles[Idx], Entry->Distances[Idx], Entry->Backpointers[Idx]);
+		if (Idx > 0)
+		{
+			OutTiles.Add(Entry->Tiles[Idx]);
+		}
+	}
+	return true;
+}
+
+void FNavGridRangeCache::Store(const FNavGridRangeCacheKey &Key, uint32 OccupancyHash, const FNavGridSearchContext &Context, const TArray<int32> &ReachedTiles, const FBox &Bounds)
+{
+	Remove(Key);
+	if (!Budget)
+	{
+		return;
+	}
+
+	FEntry NewEntry;
+	NewEntry.Tiles.Reserve(ReachedTiles.Num() + 1);
+	NewEntry.Distances.Reserve(ReachedTiles.Num() + 1);
+	NewEntry.Backpointers.Reserve(ReachedTiles.Num() + 1);
+	auto AddTile = [&NewEntry, &Context](int32 TileIndex)
+	{
+		NewEntry.Tiles.Add(TileIndex);
+		NewEntry.Distances.Add(Context.GetDistance(TileIndex));
+		NewEntry.Backpointers.Add(Context.GetBackpointer(TileIndex));
+	};
+	AddTile(Key.StartIndex);
+	for (int32 TileIndex : ReachedTiles)
+	{
+		AddTile(TileIndex);
+	}
+	NewEntry.Bounds = Bounds;
+	NewEntry.OccupancyHash = OccupancyHash;
+	NewEntry.LastUsed = ++UseCounter;
+
+	AllocatedSize += NewEntry.GetAllocatedSize();
+	Entries.Add(Key, MoveTemp(NewEntry));
+	EvictToBudget();
+}
+
+void FNavGridRangeCache::Invalidate(const FBox &Bounds)
+{
+	for (auto Itr = Entries.CreateIterator(); Itr; ++Itr)
+	{
+		if (Itr.Value().Bounds.Intersect(Bounds))
+		{
+			AllocatedSize -= Itr.Value().GetAllocatedSize();
+			Itr.RemoveCurrent();
+		}
+	}
+}
+
+void FNavGridRangeCache::Empty()
+{
+	Entries.Empty();
+	AllocatedSize = 0;
+}
+
+void FNavGridRangeCache::SetBudget(SIZE_T Bytes)
+{
+	Budget = Bytes;
+	EvictToBudget();
+}
+
+void FNavGridRangeCache::Remove(const FNavGridRangeCacheKey &Key)
+{
+	FEntry *Entry = Entries.Find(Key);
+	if (Entry)
+	{
+		AllocatedSize -= Entry->GetAllocatedSize();
+		Entries.Remove(Key);
+	}
+}
+
+void FNavGridRangeCache::EvictToBudget()
+{
+	// there are only ever a handful of entries, a linear search for the oldest one is fine
+	while (AllocatedSize > Budget && Entries.Num())
+	{
+		const FNavGridRangeCacheKey *Oldest = nullptr;
+		uint64 OldestUse = MAX_uint64;
+		for (const auto &Pair : Entries)
+		{
+			if (Pair.Value.LastUsed < OldestUse)
+			{
+				OldestUse = Pair.Value.LastUsed;
+				Oldest = &Pair.Key;
+			}
+		}
+		Remove(FNavGridRangeCacheKey(*Oldest));
+	}
+}
+
+SIZE_T FNavGridRangeCache::FEntry::GetAllocatedSize() const
+{
+	return sizeof(FNavGridRangeCacheKey) + sizeof(FEntry) + Tiles.GetAllocatedSize() + Distances.GetAllocatedSize() + Backpointers.GetAllocatedSize();
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridSearchContext.h"
+#include "NavGridPrivatePCH.h"
+
+void FNavGridSearchContext::Reset(int32 NumTiles)
+{
+	Grow(NumTiles);
+	OpenSet.Empty();
+	NumExpanded = 0;
+
+	Generation++;
+	// on the (very) rare occasion that we wrap around, stale stamps could match the new generation
+	if (Generation == 0)
+	{
+		FMemory::Memzero(DistanceGeneration.GetData(), DistanceGeneration.Num() * sizeof(uint32));
+		FMemory::Memzero(VisitedGeneration.GetData(), VisitedGeneration.Num() * sizeof(uint32));
+		FMemory::Memzero(BlockedGeneration.GetData(), BlockedGeneration.Num() * sizeof(uint32));
+		Generation = 1;
+	}
+}
+
+void FNavGridSearchContext::SetDistance(int32 TileIndex, float InDistance, int32 InBackpointer)
+{
+	Grow(TileIndex + 1);
+	Distance[TileIndex] = InDistance;
+	Backpointer[TileIndex] = InBackpointer;
+	DistanceGeneration[TileIndex] = Generation;
+}
+
+void FNavGridSearchContext::SetVisited(int32 TileIndex)
+{
+	Grow(TileIndex + 1);
+	VisitedGeneration[TileIndex] = Generation;
+}
+
+void FNavGridSearchContext::SetBlocked(int32 TileIndex)
+{
+	Grow(TileIndex + 1);
+	BlockedGeneration[TileIndex] = Generation;
+}
+
+void FNavGridSearchContext::Grow(int32 NumTiles)
+{
+	if (NumTiles > Distance.Num())
+	{
+		Distance.SetNumUninitialized(NumTiles);
+		Backpointer.SetNumUninitialized(NumTiles);
+		DistanceGeneration.SetNumZeroed(NumTiles);
+		VisitedGeneration.SetNumZeroed(NumTiles);
+		BlockedGeneration.SetNumZeroed(NumTiles);
+	}
+}
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridSnapshot.h"
+#include "NavGridPrivatePCH.h"
+
+#include <limits>
+
+namespace
+{
+	/* How often a search checks if it has been cancelled */
+	const int32 CancelCheckInterval = 256;
+}
+
+FNavGridSnapshot::FNavGridSnapshot(const ANavGrid &Grid)
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FNavGridSnapshot_Create);
+	check(IsInGameThread());
+
+	const int32 NumTiles = Grid.GetNumTileIndices();
+	Locations.SetNumZeroed(NumTiles);
+	Costs.SetNumZeroed(NumTiles);
+	TraversableMasks.SetNumZeroed(NumTiles);
+	EdgeOffsets.Reserve(NumTiles + 1);
+
+	BakedProfiles = ~0u;
+	MinTileCost = std::numeric_limits<float>::infinity();
+	MaxStepLength = Grid.TileSize;
+	for (int32 Idx = 0; Idx < NumTiles; Idx++)
+	{
+		EdgeOffsets.Add(EdgeTargets.Num());
+		if (!Grid.IsValidTileIndex(Idx))
+		{
+			continue;
+		}
+
+		const FNavGridTileRecord &Record = Grid.GetTileRecord(Idx);
+		Locations[Idx] = Record.Location;
+		Costs[Idx] = Record.Cost;
+		TraversableMasks[Idx] = Record.TraversableMasks;
+		BakedProfiles &= Record.BakedProfiles;
+		MinTileCost = FMath::Min(MinTileCost, Record.Cost);
+		for (const FNavTileEdge &Edge : Record.Edges)
+		{
+			if (Grid.IsValidTileIndex(Edge.TileIndex))
+			{
+				EdgeTargets.Add(Edge.TileIndex);
+				EdgeObstructedProfiles.Add(Edge.ObstructedProfiles);
+				FVector Delta = Grid.GetTileRecord(Edge.TileIndex).Location - Locations[Idx];
+				MaxStepLength = FMath::Max3(MaxStepLength, FMath::Abs(Delta.X), FMath::Abs(Delta.Y));
+			}
+		}
+	}
+	EdgeOffsets.Add(EdgeTargets.Num());
+	MinTileCost = FMath::Max(MinTileCost, 0.0f);
+	if (!FMath::IsFinite(MinTileCost))
+	{
+		MinTileCost = 0;
+	}
+}
+
+float FNavGridSnapshot::EstimateCost(int32 From, int32 To) const
+{
+	FVector Delta = Locations[To] - Locations[From];
+	return MinTileCost * FMath::Max(FMath::Abs(Delta.X), FMath::Abs(Delta.Y)) / MaxStepLength;
+}
+
+bool FNavGridSnapshot::Search(const FNavGridQueryParams &Params, const FThreadSafeBool &bCancelled, FNavGridSearchContext &Context, TArray<int32> &OutTiles) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_FNavGridSnapshot_Search);
+
+	OutTiles.Reset();
+	Context.Reset(Locations.Num());
+	if (!Locations.IsValidIndex(Params.StartIndex) || (Params.TargetIndex != INDEX_NONE && !Locations.IsValidIndex(Params.TargetIndex)) ||
+		Params.Profile < 0 || Params.Profile >= 32)
+	{
+		return false;
+	}
+
+	for (int32 Index : Params.BlockedTiles)
+	{
+		if (Locations.IsValidIndex(Index))
+		{
+			Context.SetBlocked(Index);
+		}
+	}
+
+	const bool bFindPath = Params.TargetIndex != INDEX_NONE;
+	const float MaxCost = Params.MaxCost < 0 ? std::numeric_limits<float>::infinity() : Params.MaxCost;
+	const uint32 ProfileBit = 1u << Params.Profile;
+	const uint32 TraversableBit = FNavGridTileRecord::GetTraversableBit(Params.MovementModeMask);
+	Context.SetDistance(Params.StartIndex, 0, INDEX_NONE);
+	Context.OpenSet.Push(Params.StartIndex, 0);
+	while (!Context.OpenSet.IsEmpty())
+	{
+		if (Context.NumExpanded % CancelCheckInterval == 0 && bCancelled)
+		{
+			return false;
+		}
+
+		int32 CurrentIndex = Context.OpenSet.Pop();
+		if (CurrentIndex == Params.TargetIndex)
+		{
+			break;
+		}
+		float CurrentDistance = Context.GetDistance(CurrentIndex);
+		Context.SetVisited(CurrentIndex);
+		Context.NumExpanded++;
+		if (!bFindPath && CurrentIndex != Params.StartIndex)
+		{
+			OutTiles.Add(CurrentIndex);
+		}
+
+		for (int32 EdgeIdx = EdgeOffsets[CurrentIndex]; EdgeIdx < EdgeOffsets[CurrentIndex + 1]; EdgeIdx++)
+		{
+			int32 NIndex = EdgeTargets[EdgeIdx];
+			if ((EdgeObstructedProfiles[EdgeIdx] & ProfileBit) || !(TraversableMasks[NIndex] & TraversableBit) ||
+				Context.IsVisited(NIndex) || Context.IsBlocked(NIndex))
+			{
+				continue;
+			}
+
+			float TentativeDistance = CurrentDistance + Costs[NIndex];
+			float Estimate = TentativeDistance + (bFindPath ? EstimateCost(NIndex, Params.TargetIndex) : 0);
+			float OldDistance = Context.GetDistance(NIndex);
+			if (Estimate > MaxCost || TentativeDistance > OldDistance)
+			{
+				continue;
+			}
+			// same tiebreak as ANavGrid::RelaxEdge(), prefer straight paths
+			if (TentativeDistance == OldDistance)
+			{
+				int32 OldBackpointer = Context.GetBackpointer(NIndex);
+				if (OldBackpointer == INDEX_NONE ||
+					FVector::DistSquared(Locations[CurrentIndex], Locations[NIndex]) >= FVector::DistSquared(Locations[OldBackpointer], Locations[NIndex]))
+				{
+					continue;
+				}
+			}
+			Context.SetDistance(NIndex, TentativeDistance, CurrentIndex);
+			Context.OpenSet.Push(NIndex, Estimate);
+		}
+	}
+
+	if (!bFindPath)
+	{
+		return true;
+	}
+	if (Params.TargetIndex != Params.StartIndex && Context.GetBackpointer(Params.TargetIndex) == INDEX_NONE)
+	{
+		return false;
+	}
+	for (int32 Index = Params.TargetIndex; Index != INDEX_NONE; Index = Context.GetBackpointer(Index))
+	{
+		OutTiles.Add(Index);
+	}
+	Algo::Reverse(OutTiles);
+	return true;
+}
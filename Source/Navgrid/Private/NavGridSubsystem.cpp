@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NavGridSubsystem.h"
+#include "NavGridPrivatePCH.h"
+
+ANavGrid *UNavGridSubsystem::GetGrid() const
+{
+	ANavGrid *Result = Grid.Get();
+	return IsValid(Result) ? Result : nullptr;
+}
+
+void UNavGridSubsystem::AddGrid(ANavGrid &InGrid)
+{
+	if (!GetGrid())
+	{
+		Grid = &InGrid;
+	}
+	if (Grid.Get() != &InGrid)
+	{
+		return;
+	}
+
+	for (const TWeakObjectPtr<UNavTileComponent> &Tile : OrphanTiles)
+	{
+		if (Tile.IsValid() && !IsValid(Tile->GetGrid()) && Tile->IsRegistered())
+		{
+			Tile->SetGrid(&InGrid);
+		}
+	}
+	OrphanTiles.Empty();
+}
+
+void UNavGridSubsystem::AddOrphanTile(UNavTileComponent &Tile)
+{
+	OrphanTiles.Add(&Tile);
+}
@@ -2,22 +2,26 @@
 
 #include "NavLadderComponent.h"
 #include "NavGridPrivatePCH.h"
+#include "GridPathBuilder.h"
 
 UNavLadderComponent::UNavLadderComponent()
 	:Super()
 {
-	MovementModes.Empty();
-	MovementModes.Add(EGridMovementMode::ClimbingUp);
-	MovementModes.Add(EGridMovementMode::ClimbingDown);
+	MovementModeFlags.Empty();
+	MovementModeFlags.Add(EGridMovementMode::ClimbingUp);
+	MovementModeFlags.Add(EGridMovementMode::ClimbingDown);
+	MovementModes_DEPRECATED = MovementModeFlags.ToSet();
 }
 
 void UNavLadderComponent::SetGrid(ANavGrid *InGrid)
 {
 	Super::SetGrid(InGrid);
 	TileSize = InGrid->TileSize;
+	// GetPawnLocation() depends on TileSize
+	UpdateTileRecord();
 }
 
-void UNavLadderComponent::GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed)
+void UNavLadderComponent::GetNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutUnObstructed, TArray<UNavTileComponent *> &OutObstructed, const FCollisionResponseParams &ResponseParams)
 {
 	OutUnObstructed.Empty();
 	OutObstructed.Empty();
@@ -43,7 +47,7 @@ void UNavLadderComponent::GetNeighbours(const UCapsuleComponent &CollisionCapsul
 			float TopDistance = (GetTopPathPoint() - N->GetPawnLocation()).Size();
 			float BottomDistance = (GetBottomPathPoint() - N->GetPawnLocation()).Size();
 			FVector TracePoint = TopDistance < BottomDistance ? GetTopPathPoint() : GetBottomPathPoint();
-			if (N->Obstructed(TracePoint, CollisionCapsule))
+			if (N->Obstructed(TracePoint, CollisionCapsule, ResponseParams))
 			{
 				OutObstructed.Add(N);
 			}
@@ -55,7 +59,7 @@ void UNavLadderComponent::GetNeighbours(const UCapsuleComponent &CollisionCapsul
 	}
 }
 
-bool UNavLadderComponent::Obstructed(const FVector & FromPos, const UCapsuleComponent & CollisionCapsule) const
+bool UNavLadderComponent::Obstructed(const FVector & FromPos, const UCapsuleComponent & CollisionCapsule, const FCollisionResponseParams &ResponseParams) const
 {
 	//Determine if we should trace to the top or bottom point
 	float TopDistance = (GetTopPathPoint() - FromPos).Size();
@@ -68,50 +72,47 @@ bool UNavLadderComponent::Obstructed(const FVector & FromPos, const UCapsuleComp
 	CQP.AddIgnoredActor(CollisionCapsule.GetOwner());
 	CQP.TraceTag = "NavGridMovement";
 	return CollisionCapsule.GetWorld()->SweepSingleByChannel(OutHit, FromPos + CollisionCapsule.GetRelativeLocation(), TracePoint + CollisionCapsule.GetRelativeLocation(),
-		GetComponentQuat(), ECollisionChannel::ECC_Pawn, CollisionShape, CQP);
+		GetComponentQuat(), ECollisionChannel::ECC_Pawn, CollisionShape, CQP, ResponseParams);
 }
 
-void UNavLadderComponent::AddPathSegments(USplineComponent &OutSpline, TArray<FPathSegment> &OutPathSegments, bool EndTile) const
+void UNavLadderComponent::AddPathSegments(FGridPathBuilder &Builder, bool EndTile) const
 {
-	FVector EntryPoint = OutSpline.GetLocationAtSplinePoint(OutSpline.GetNumberOfSplinePoints() - 1, ESplineCoordinateSpace::Local);
+	FVector EntryPoint = Builder.GetLastPoint();
 	float TopDistance = (GetTopPathPoint() - EntryPoint).Size();
 	float BottomDistance = (GetBottomPathPoint() - EntryPoint).Size();
 
 	FPathSegment NewSegment;
-	NewSegment.MovementModes = MovementModes;
+	NewSegment.MovementModes = MovementModeFlags;
 	NewSegment.PawnRotationHint = GetComponentRotation();
 	NewSegment.PawnRotationHint.Yaw -= 180;
 
 	// add spline points and segments
+	int32 SegmentStart;
+	int32 SegmentEnd;
 	if (TopDistance > BottomDistance)
 	{
-		OutSpline.AddSplinePoint(GetBottomPathPoint(), ESplineCoordinateSpace::Local);
-		NewSegment.Start = OutSpline.GetSplineLength();
-		OutSpline.AddSplinePoint(GetTopPathPoint(), ESplineCoordinateSpace::Local);
-		NewSegment.End = OutSpline.GetSplineLength();
+		SegmentStart = Builder.AddPoint(GetBottomPathPoint());
+		SegmentEnd = Builder.AddPoint(GetTopPathPoint());
 	}
 	else
 	{
-		OutSpline.AddSplinePoint(GetTopPathPoint(), ESplineCoordinateSpace::Local);
-		NewSegment.Start = OutSpline.GetSplineLength();
-		OutSpline.AddSplinePoint(GetBottomPathPoint(), ESplineCoordinateSpace::Local);
-		NewSegment.End = OutSpline.GetSplineLength();
+		SegmentStart = Builder.AddPoint(GetTopPathPoint());
+		SegmentEnd = Builder.AddPoint(GetBottomPathPoint());
 	}
 
 	// unlike regular tiles, we do not want the pawn to change movement mode untill it reaches the first path point
 	// we therefore extend the previous segment to that point
-	if (OutPathSegments.Num())
+	if (Builder.GetNumSegments())
 	{
-		OutPathSegments.Last().End = NewSegment.Start;
+		Builder.SetLastSegmentEnd(SegmentStart);
 	}
 
 	// add the new segment
-	OutPathSegments.Add(NewSegment);
+	Builder.AddSegment(NewSegment, SegmentStart, SegmentEnd);
 
 	if (EndTile)
 	{
-		OutSpline.RemoveSplinePoint(OutSpline.GetNumberOfSplinePoints() - 1);
-		OutSpline.AddSplinePoint(PawnLocationOffset + GetComponentLocation(), ESplineCoordinateSpace::Local);
+		Builder.SetPointLocation(SegmentEnd, PawnLocationOffset + GetComponentLocation());
 	}
 }
 
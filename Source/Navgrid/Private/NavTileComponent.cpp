@@ -3,6 +3,8 @@
 #include "NavTileComponent.h"
 #include "NavGridPrivatePCH.h"
 #include <limits>
+#include "GridPathBuilder.h"
+#include "NavGridSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "DrawDebugHelpers.h"
 
@@ -27,23 +29,159 @@ UNavTileComponent::UNavTileComponent()
 	SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Block); // So we get mouse over events
 	SetCollisionResponseToChannel(ANavGrid::ECC_NavGridWalkable, ECollisionResponse::ECR_Overlap); // So we can find the floor with a line trace
 
-	MovementModes.Add(EGridMovementMode::Stationary);
-	MovementModes.Add(EGridMovementMode::Walking);
-	MovementModes.Add(EGridMovementMode::InPlaceTurn);
+	MovementModeFlags.Add(EGridMovementMode::Stationary);
+	MovementModeFlags.Add(EGridMovementMode::Walking);
+	MovementModeFlags.Add(EGridMovementMode::InPlaceTurn);
+	// the old default, kept for data that did not save the set because it was not changed
+	MovementModes_DEPRECATED = MovementModeFlags.ToSet();
 
 	ShapeColor = FColor::Magenta;
+}
+
+void UNavTileComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	// add ourself to the grid, so it never has to search the world for tiles
+	if (!IsValid(Grid))
+	{
+		UWorld *World = GetWorld();
+		UNavGridSubsystem *Subsystem = World ? World->GetSubsystem<UNavGridSubsystem>() : nullptr;
+		if (Subsystem && Subsystem->GetGrid())
+		{
+			SetGrid(Subsystem->GetGrid());
+		}
+		else if (Subsystem)
+		{
+			// the grid picks us up when it is registered
+			Subsystem->AddOrphanTile(*this);
+		}
+	}
+	else if (TileIndex == INDEX_NONE)
+	{
+		Grid->RegisterTile(this);
+	}
+}
+
+void UNavTileComponent::OnUnregister()
+{
+	if (IsValid(Grid))
+	{
+		Grid->UnregisterTile(this);
+	}
+	Super::OnUnregister();
+}
 
-	Reset();
+void UNavTileComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+	if (IsValid(Grid) && TileIndex != INDEX_NONE)
+	{
+		Grid->UpdateTileLocation(this);
+	}
+}
+
+void UNavTileComponent::Serialize(FArchive &Ar)
+{
+	Super::Serialize(Ar);
+	Ar.UsingCustomVersion(FNavGridCustomVersion::GUID);
+}
+
+void UNavTileComponent::PostLoad()
+{
+	Super::PostLoad();
+	// MovementModes used to be saved as a TSet, see NavGridPluginImpl::StartupModule() for the redirect. An empty set is converted as well
+	if (FNavGridCustomVersion::NeedsConversion(*this, FNavGridCustomVersion::MovementModeFlags))
+	{
+		MovementModeFlags = FGridMovementModes(MovementModes_DEPRECATED);
+	}
+}
+
+#if WITH_EDITOR
+void UNavTileComponent::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	UpdateTileRecord();
+}
+#endif // WITH_EDITOR
+
+void UNavTileComponent::SetCost(float InCost)
+{
+	Cost = InCost;
+	UpdateTileRecord();
+}
+
+void UNavTileComponent::SetMovementModeFlags(const FGridMovementModes &InMovementModes)
+{
+	MovementModeFlags = InMovementModes;
+	UpdateTileRecord();
 }
 
-bool UNavTileComponent::Traversable(const TSet<EGridMovementMode>& PawnMovementModes) const
+void UNavTileComponent::SetMovementModes(const TSet<EGridMovementMode> &InMovementModes)
 {
-	return MovementModes.Intersect(PawnMovementModes).Num() > 0;
+	SetMovementModeFlags(FGridMovementModes(InMovementModes));
+}
+
+void UNavTileComponent::GetTileRecord(FNavGridTileRecord &OutRecord) const
+{
+	GetTilePlacement(OutRecord);
+	OutRecord.Cost = Cost;
+	// Traversable() only depends on the movement modes of the pawn, so ask it once for every combination of them
+	static_assert((uint8)EGridMovementMode::InPlaceTurn < 5, "FNavGridTileRecord::TraversableMasks only has room for five movement modes");
+	OutRecord.TraversableMasks = 0;
+	FGridMovementModes PawnMovementModes;
+	for (uint32 PawnMask = 0; PawnMask < FNavGridTileRecord::NumMovementModeMasks; PawnMask++)
+	{
+		PawnMovementModes.Mask = PawnMask;
+		if (Traversable(PawnMovementModes))
+		{
+			OutRecord.TraversableMasks |= 1u << PawnMask;
+		}
+	}
+}
+
+void UNavTileComponent::GetTilePlacement(FNavGridTileRecord &OutRecord) const
+{
+	const FTransform &Transform = GetComponentTransform();
+	OutRecord.Location = Transform.GetLocation();
+	OutRecord.Rotation = Transform.GetRotation();
+	OutRecord.Extent = GetScaledBoxExtent();
+	// bounds are not updated yet when this is called from OnUpdateTransform(), so calculate them ourself
+	OutRecord.Bounds = CalcBounds(Transform).GetBox();
+	OutRecord.PawnOffset = GetPawnLocation() - OutRecord.Location;
+}
+
+void UNavTileComponent::UpdateTileRecord()
+{
+	if (IsValid(Grid) && TileIndex != INDEX_NONE)
+	{
+		Grid->UpdateTileRecord(*this);
+	}
+}
+
+bool UNavTileComponent::Traversable(const FGridMovementModes &PawnMovementModes) const
+{
+	// subclasses may still override the old signature
+	PRAGMA_DISABLE_DEPRECATION_WARNINGS
+	return Traversable(PawnMovementModes.ToSet());
+	PRAGMA_ENABLE_DEPRECATION_WARNINGS
+}
+
+bool UNavTileComponent::LegalPositionAtEndOfTurn(const FGridMovementModes &PawnMovementModes) const
+{
+	PRAGMA_DISABLE_DEPRECATION_WARNINGS
+	return LegalPositionAtEndOfTurn(PawnMovementModes.ToSet());
+	PRAGMA_ENABLE_DEPRECATION_WARNINGS
+}
+
+bool UNavTileComponent::Traversable(const TSet<EGridMovementMode> &PawnMovementModes) const
+{
+	return MovementModeFlags.Overlaps(FGridMovementModes(PawnMovementModes));
 }
 
 bool UNavTileComponent::LegalPositionAtEndOfTurn(const TSet<EGridMovementMode> &PawnMovementModes) const
 {
-	return MovementModes.Contains(EGridMovementMode::Stationary);
+	return MovementModeFlags.Contains(EGridMovementMode::Stationary);
 }
 
 FVector UNavTileComponent::GetPawnLocation() const
@@ -54,11 +192,20 @@ FVector UNavTileComponent::GetPawnLocation() const
 void UNavTileComponent::SetPawnLocationOffset(const FVector &Offset)
 {
 	PawnLocationOffset = Offset;
+	UpdateTileRecord();
 }
 
 void UNavTileComponent::SetGrid(ANavGrid * InGrid)
 {
+	if (Grid != InGrid && IsValid(Grid))
+	{
+		Grid->UnregisterTile(this);
+	}
 	Grid = InGrid;
+	if (IsValid(Grid) && TileIndex == INDEX_NONE)
+	{
+		Grid->RegisterTile(this);
+	}
 }
 
 ANavGrid * UNavTileComponent::GetGrid() const
@@ -66,19 +213,27 @@ ANavGrid * UNavTileComponent::GetGrid() const
 	return Grid;
 }
 
-void UNavTileComponent::Reset()
+float UNavTileComponent::GetDistance() const
 {
-	Distance = std::numeric_limits<float>::infinity();
-	Backpointer = NULL;
-	Visited = false;
+	return IsValid(Grid) ? Grid->GetDistance(*this) : std::numeric_limits<float>::infinity();
 }
 
-bool UNavTileComponent::Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule) const
+UNavTileComponent *UNavTileComponent::GetBackpointer() const
 {
-	return Obstructed(FromPos + CollisionCapsule.GetRelativeLocation(), GetPawnLocation() + CollisionCapsule.GetRelativeLocation(), CollisionCapsule);
+	return IsValid(Grid) ? Grid->GetBackpointer(*this) : nullptr;
 }
 
-bool UNavTileComponent::Obstructed(const FVector &From, const FVector &To, const UCapsuleComponent &CollisionCapsule) const
+bool UNavTileComponent::IsVisited() const
+{
+	return IsValid(Grid) && Grid->IsVisited(*this);
+}
+
+bool UNavTileComponent::Obstructed(const FVector &FromPos, const UCapsuleComponent &CollisionCapsule, const FCollisionResponseParams &ResponseParams) const
+{
+	return Obstructed(FromPos + CollisionCapsule.GetRelativeLocation(), GetPawnLocation() + CollisionCapsule.GetRelativeLocation(), CollisionCapsule, ResponseParams);
+}
+
+bool UNavTileComponent::Obstructed(const FVector &From, const FVector &To, const UCapsuleComponent &CollisionCapsule, const FCollisionResponseParams &ResponseParams) const
 {
 	FHitResult OutHit;
 	FQuat Rot = FQuat::Identity;
@@ -86,10 +241,10 @@ bool UNavTileComponent::Obstructed(const FVector &From, const FVector &To, const
 	FCollisionQueryParams CQP;
 	CQP.AddIgnoredActor(CollisionCapsule.GetOwner());
 	CQP.TraceTag = "NavGridMovement";
-	return CollisionCapsule.GetWorld()->SweepSingleByChannel(OutHit, From, To, Rot, ECollisionChannel::ECC_Pawn, CollisionShape, CQP);
+	return CollisionCapsule.GetWorld()->SweepSingleByChannel(OutHit, From, To, Rot, ECollisionChannel::ECC_Pawn, CollisionShape, CQP, ResponseParams);
 }
 
-void UNavTileComponent::GetNeighbours(const UCapsuleComponent & CollisionCapsule, TArray<UNavTileComponent*>& OutUnObstructed, TArray<UNavTileComponent*>& OutObstructed)
+void UNavTileComponent::GetNeighbours(const UCapsuleComponent & CollisionCapsule, TArray<UNavTileComponent*>& OutUnObstructed, TArray<UNavTileComponent*>& OutObstructed, const FCollisionResponseParams &ResponseParams)
 {
 	QUICK_SCOPE_CYCLE_COUNTER(STAT_UNavTileComponent_GetNeighbours);
 
@@ -106,7 +261,7 @@ void UNavTileComponent::GetNeighbours(const UCapsuleComponent & CollisionCapsule
 			UNavTileComponent *HitTile = Cast<UNavTileComponent>(Hit.GetComponent());
 			if (IsValid(HitTile))
 			{
-				if (HitTile != this && !HitTile->Obstructed(GetPawnLocation(), CollisionCapsule))
+				if (HitTile != this && !HitTile->Obstructed(GetPawnLocation(), CollisionCapsule, ResponseParams))
 				{
 					OutUnObstructed.AddUnique(HitTile);
 				}
@@ -119,10 +274,10 @@ void UNavTileComponent::GetNeighbours(const UCapsuleComponent & CollisionCapsule
 	}
 }
 
-void UNavTileComponent::GetUnobstructedNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutNeighbours)
+void UNavTileComponent::GetUnobstructedNeighbours(const UCapsuleComponent &CollisionCapsule, TArray<UNavTileComponent *> &OutNeighbours, const FCollisionResponseParams &ResponseParams)
 {
 	TArray<UNavTileComponent *> Dummy;
-	GetNeighbours(CollisionCapsule, OutNeighbours, Dummy);
+	GetNeighbours(CollisionCapsule, OutNeighbours, Dummy, ResponseParams);
 }
 
 void UNavTileComponent::Clicked(UPrimitiveComponent* TouchedComponent, FKey Key)
@@ -155,12 +310,11 @@ void UNavTileComponent::TouchEnd(ETouchIndex::Type Type, UPrimitiveComponent* To
 	Grid->TileClicked(this);
 }
 
-void UNavTileComponent::AddPathSegments(USplineComponent &OutSpline, TArray<FPathSegment> &OutPathSegments, bool EndTile) const
+void UNavTileComponent::AddPathSegments(FGridPathBuilder &Builder, bool EndTile) const
 {
-	FVector EntryPoint = OutSpline.GetLocationAtSplinePoint(OutSpline.GetNumberOfSplinePoints() - 1, ESplineCoordinateSpace::Local);
-	float SegmentStart = OutSpline.GetSplineLength();
-	OutSpline.AddSplinePoint(GetComponentLocation() + PawnLocationOffset, ESplineCoordinateSpace::Local);
-	OutPathSegments.Add(FPathSegment(MovementModes, SegmentStart, OutSpline.GetSplineLength()));
+	int32 SegmentStart = Builder.GetNumPoints() - 1;
+	int32 SegmentEnd = Builder.AddPoint(GetComponentLocation() + PawnLocationOffset);
+	Builder.AddSegment(FPathSegment(MovementModeFlags, 0, 0), SegmentStart, SegmentEnd);
 }
 
 FVector UNavTileComponent::GetSplineMeshUpVector()
@@ -170,17 +324,20 @@ FVector UNavTileComponent::GetSplineMeshUpVector()
 
 void UNavTileComponent::SetHighlight(FName NewHighlightType)
 {
-	auto *HighlightComponent = Grid->GetHighlightComponent(NewHighlightType);
-	if (HighlightComponent)
+	if (IsValid(Grid))
 	{
-		FVector MeshSize = HighlightComponent->GetStaticMesh()->GetBoundingBox().GetSize();
-		FVector TileSize = GetScaledBoxExtent() * 2;
-		FTransform Transform = GetComponentTransform();
-		Transform.SetScale3D(FVector(TileSize.X / MeshSize.X, TileSize.Y / MeshSize.Y, 1));
-		HighlightComponent->AddInstanceWorldSpace(Transform);
+		Grid->SetTileHighlight(*this, NewHighlightType);
 	}
 }
 
+FTransform UNavTileComponent::GetHighlightTransform(const FVector &MeshSize) const
+{
+	FVector TileSize = GetScaledBoxExtent() * 2;
+	FTransform Transform = GetComponentTransform();
+	Transform.SetScale3D(FVector(TileSize.X / MeshSize.X, TileSize.Y / MeshSize.Y, 1));
+	return Transform;
+}
+
 void UNavTileComponent::DrawDebug(UCapsuleComponent *CollisionCapsule, bool bPersistentLines, float LifeTime, float Thickness)
 {
 	DrawDebugCapsule(GetWorld(), GetPawnLocation() + CollisionCapsule->GetRelativeLocation(), CollisionCapsule->GetScaledCapsuleHalfHeight(), CollisionCapsule->GetScaledCapsuleRadius(),
@@ -8,6 +8,8 @@ UTurnComponent::UTurnComponent()
 	TurnManager(nullptr),
 	StartingActionPoints(1),
 	RemainingActionPoints(1),
+	Speed(1),
+	InitiativeTime(0),
 	TurnTimeout(30)
 {
 }
@@ -115,6 +117,11 @@ void UTurnComponent::UnregisterWithTurnManager()
 
 void UTurnComponent::OnTurnStart()
 {
+	// simulations do not wait for the clock
+	if (IsValid(TurnManager) && TurnManager->bSimulate)
+	{
+		return;
+	}
 	GetWorld()->GetTimerManager().SetTimer(TurnTimeoutHandle, this, &UTurnComponent::OnTurnTimeout, TurnTimeout);
 }
 
@@ -1,101 +1,260 @@
-
 #include "TurnManager.h"
 #include "NavGridPrivatePCH.h"
 
 ATurnManager::ATurnManager() :
 	MinNumberOfTeams(1),
+	TurnOrder(ETurnOrder::Team),
+	bSimulate(false),
 	CurrentComponent(nullptr),
 	NextComponent(nullptr),
 	Round(0),
-	bStartNewTurn(true)
+	bStartNewTurn(true),
+	bTransitionScheduled(false),
+	InitiativeClock(0)
 {
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 }
 
-void ATurnManager::Tick(float DeltaTime)
+void ATurnManager::BeginPlay()
 {
-	Super::Tick(DeltaTime);
+	Super::BeginPlay();
 
-	TArray<FGenericTeamId> Keys;
-	Teams.GetKeys(Keys);
-	if (bStartNewTurn && Keys.Num() >= MinNumberOfTeams)
+	// components may have registered before we began play
+	if (bStartNewTurn)
 	{
-		// broadcast TurnEnd and TeamTurnEnd
-		if (IsValid(CurrentComponent))
+		ScheduleTurnTransition();
+	}
+}
+
+void ATurnManager::ScheduleTurnTransition()
+{
+	bStartNewTurn = true;
+	UWorld *World = GetWorld();
+	// when simulating SimulateTurns() picks up the request
+	if (!bTransitionScheduled && World && !bSimulate)
+	{
+		bTransitionScheduled = true;
+		World->GetTimerManager().SetTimerForNextTick(this, &ATurnManager::OnTurnTransitionTimer);
+	}
+}
+
+void ATurnManager::OnTurnTransitionTimer()
+{
+	bTransitionScheduled = false;
+	// a simulation may have started after the timer was set
+	if (!bSimulate)
+	{
+		StartNewTurn();
+	}
+}
+
+int32 ATurnManager::SimulateTurns(int32 MaxTurns)
+{
+	// the AI usually ends its turn from OnTurnStart(), which requests the next turn before StartNewTurn() returns
+	int32 NumTurns = 0;
+	while (NumTurns < MaxTurns && IsTurnPending())
+	{
+		StartNewTurn();
+		NumTurns++;
+	}
+	return NumTurns;
+}
+
+void ATurnManager::StartNewTurn()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_ATurnManager_StartNewTurn);
+
+	// we will be scheduled again when the next team registers
+	if (!IsTurnPending())
+	{
+		return;
+	}
+
+	// broadcast TurnEnd and TeamTurnEnd
+	if (IsValid(CurrentComponent))
+	{
+		CurrentComponent->OnTurnEnd();
+		OnTurnEnd().Broadcast(CurrentComponent);
+		RequeueInitiative(*CurrentComponent);
+
+		// with initiative order the team turn ends as soon as someone from another team is up next
+		bool bTeamTurnEnded;
+		if (TurnOrder == ETurnOrder::Initiative)
 		{
-			CurrentComponent->OnTurnEnd();
-			OnTurnEnd().Broadcast(CurrentComponent);
-			if (!IsValid(FindNextTeamMember(CurrentComponent->TeamId())))
-			{
-				OnTeamTurnEnd().Broadcast(CurrentComponent->TeamId());
-			}
+			UTurnComponent *Upcoming = FindNextInitiative();
+			bTeamTurnEnded = !IsValid(Upcoming) || Upcoming->TeamId() != CurrentComponent->TeamId();
 		}
-
-		// start a new round if no more components can act this turn
-		if (Round == 0 || !HasComponentsThatCanAct())
+		else
 		{
-			if (Round > 0)
-			{
-				OnRoundEnd().Broadcast();
-			}
-
-			for (TPair<FGenericTeamId, UTurnComponent *> &Pair : Teams)
-			{
-				Pair.Value->RemainingActionPoints = Pair.Value->StartingActionPoints;
-			}
+			bTeamTurnEnded = !IsValid(FindNextTeamMember(CurrentComponent->TeamId()));
+		}
+		if (bTeamTurnEnded)
+		{
+			OnTeamTurnEnd().Broadcast(CurrentComponent->TeamId());
+		}
+	}
 
-			CurrentComponent = nullptr;
-			NextComponent = nullptr;
+	// figure out which component that has the next turn
+	if (!IsValid(NextComponent) || NextComponent->RemainingActionPoints <= 0)
+	{
+		if (TurnOrder == ETurnOrder::Team && IsValid(CurrentComponent) && CurrentComponent->RemainingActionPoints > 0)
+		{
+			NextComponent = CurrentComponent;
+		}
+		else
+		{
+			NextComponent = FindNextComponent();
+		}
+	}
 
-			Round++;
-			UE_LOG(NavGrid, Log, TEXT("Starting round %i"), Round);
-			OnRoundStart().Broadcast();
+	// start a new round if no more components can act this turn. With initiative order a round lasts one unit of
+	// initiative time, so a component with twice the speed gets twice as many turns in it
+	const bool bRoundEnded = TurnOrder == ETurnOrder::Initiative
+		? !IsValid(NextComponent) || NextComponent->InitiativeTime > Round
+		: !IsValid(NextComponent);
+	if (Round == 0 || bRoundEnded)
+	{
+		if (Round > 0)
+		{
+			OnRoundEnd().Broadcast();
 		}
 
-		// figure out which component that has the next turn
-		if (!IsValid(NextComponent) || NextComponent->RemainingActionPoints <= 0)
+		for (FTurnManagerTeam &Team : Teams)
 		{
-			if (IsValid(CurrentComponent) && CurrentComponent->RemainingActionPoints > 0)
+			Team.Cursor = INDEX_NONE;
+			for (UTurnComponent *Member : Team.Members)
 			{
-				NextComponent = CurrentComponent;
-			}
-			else
-			{
-				NextComponent = FindNextComponent();
+				Member->RemainingActionPoints = Member->StartingActionPoints;
 			}
 		}
 
-		// broadcast TurnStart and TeamTurnStart
-		check(IsValid(NextComponent))
-		UTurnComponent *PreviousComponent = CurrentComponent;
-		CurrentComponent = NextComponent;
-		if (!IsValid(PreviousComponent) || CurrentComponent->TeamId() != PreviousComponent->TeamId())
+		UTurnComponent *UpcomingInitiative = NextComponent;
+		CurrentComponent = nullptr;
+		NextComponent = nullptr;
+
+		// skip the rounds nobody had a turn in when everyone is slower than one turn per round
+		Round = TurnOrder == ETurnOrder::Initiative && IsValid(UpcomingInitiative)
+			? FMath::Max(Round + 1, FMath::CeilToInt(UpcomingInitiative->InitiativeTime))
+			: Round + 1;
+		UE_LOG(NavGrid, Log, TEXT("Starting round %i"), Round);
+		OnRoundStart().Broadcast();
+
+		// someone may have requested a turn when the round started
+		if (!IsValid(NextComponent) || NextComponent->RemainingActionPoints <= 0)
 		{
-			UE_LOG(NavGrid, Log, TEXT("Starting team turn for team %i"), CurrentComponent->TeamId().GetId());
-			OnTeamTurnStart().Broadcast(CurrentComponent->TeamId());
+			NextComponent = FindNextComponent();
 		}
-		CurrentComponent->OnTurnStart();
-		OnTurnStart().Broadcast(CurrentComponent);
+	}
 
-		NextComponent = nullptr;
-		bStartNewTurn = false;
+	// broadcast TurnStart and TeamTurnStart
+	check(IsValid(NextComponent))
+	UTurnComponent *PreviousComponent = CurrentComponent;
+	CurrentComponent = NextComponent;
+	NextComponent = nullptr;
+	InitiativeQueue.Remove(CurrentComponent->InitiativeSlot);
+	InitiativeClock = FMath::Max(InitiativeClock, CurrentComponent->InitiativeTime);
+	if (TurnOrder == ETurnOrder::Initiative)
+	{
+		// turns are granted by initiative time, action points only limit what can be done during a single turn
+		CurrentComponent->RemainingActionPoints = CurrentComponent->StartingActionPoints;
+	}
+	FTurnManagerTeam *CurrentTeam = FindTeam(CurrentComponent->RosterTeamId);
+	if (CurrentTeam)
+	{
+		CurrentTeam->Cursor = CurrentComponent->RosterIndex;
+	}
+
+	// requests made from here on are for the turn after this one
+	bStartNewTurn = false;
+	if (!IsValid(PreviousComponent) || CurrentComponent->TeamId() != PreviousComponent->TeamId())
+	{
+		UE_LOG(NavGrid, Log, TEXT("Starting team turn for team %i"), CurrentComponent->TeamId().GetId());
+		OnTeamTurnStart().Broadcast(CurrentComponent->TeamId());
 	}
+	CurrentComponent->OnTurnStart();
+	OnTurnStart().Broadcast(CurrentComponent);
 }
 
 void ATurnManager::RegisterTurnComponent(UTurnComponent *TurnComponent)
 {
-	UE_LOG(NavGrid, Verbose, TEXT("%s (team %i) registering"), *TurnComponent->GetName(), TurnComponent->TeamId().GetId());
-	Teams.AddUnique(TurnComponent->TeamId(), TurnComponent);
+	if (TurnComponent->RosterIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	FGenericTeamId TeamId = TurnComponent->TeamId();
+	UE_LOG(NavGrid, Verbose, TEXT("%s (team %i) registering"), *TurnComponent->GetName(), TeamId.GetId());
+
+	// keep Teams sorted so FindNextComponent() never has to sort it
+	int32 TeamIdx = 0;
+	while (TeamIdx < Teams.Num() && Teams[TeamIdx].TeamId.GetId() < TeamId.GetId())
+	{
+		TeamIdx++;
+	}
+	if (TeamIdx == Teams.Num() || Teams[TeamIdx].TeamId != TeamId)
+	{
+		Teams.InsertDefaulted(TeamIdx);
+		Teams[TeamIdx].TeamId = TeamId;
+	}
+
+	TurnComponent->RosterTeamId = TeamId;
+	TurnComponent->RosterIndex = Teams[TeamIdx].Members.Add(TurnComponent);
+
+	if (FreeInitiativeSlots.Num())
+	{
+		TurnComponent->InitiativeSlot = FreeInitiativeSlots.Pop(false);
+		InitiativeSlots[TurnComponent->InitiativeSlot] = TurnComponent;
+	}
+	else
+	{
+		TurnComponent->InitiativeSlot = InitiativeSlots.Add(TurnComponent);
+	}
+	// newcomers get to act after waiting a single action from now
+	TurnComponent->InitiativeTime = InitiativeClock;
+	RequeueInitiative(*TurnComponent);
+
+	if (bStartNewTurn)
+	{
+		ScheduleTurnTransition();
+	}
 }
 
 void ATurnManager::UnregisterTurnComponent(UTurnComponent * TurnComponent)
 {
-	UE_LOG(NavGrid, Verbose, TEXT("%s (team %i) unregistering"), *TurnComponent->GetName(), TurnComponent->TeamId().GetId());
-	Teams.RemoveSingle(TurnComponent->TeamId(), TurnComponent);
+	UE_LOG(NavGrid, Verbose, TEXT("%s (team %i) unregistering"), *TurnComponent->GetName(), TurnComponent->RosterTeamId.GetId());
+	FTurnManagerTeam *Team = FindTeam(TurnComponent->RosterTeamId);
+	if (Team && Team->Members.IsValidIndex(TurnComponent->RosterIndex) && Team->Members[TurnComponent->RosterIndex] == TurnComponent)
+	{
+		// keep the order of the remaining members so the round robin is not disturbed
+		int32 RemovedIndex = TurnComponent->RosterIndex;
+		Team->Members.RemoveAt(RemovedIndex);
+		for (int32 Idx = RemovedIndex; Idx < Team->Members.Num(); Idx++)
+		{
+			Team->Members[Idx]->RosterIndex = Idx;
+		}
+		if (Team->Cursor >= RemovedIndex)
+		{
+			Team->Cursor--;
+		}
+		if (Team->Members.Num() == 0)
+		{
+			Teams.RemoveAt(Team - Teams.GetData());
+		}
+	}
+	TurnComponent->RosterIndex = INDEX_NONE;
+
+	if (InitiativeSlots.IsValidIndex(TurnComponent->InitiativeSlot) && InitiativeSlots[TurnComponent->InitiativeSlot] == TurnComponent)
+	{
+		InitiativeQueue.Remove(TurnComponent->InitiativeSlot);
+		InitiativeSlots[TurnComponent->InitiativeSlot] = nullptr;
+		FreeInitiativeSlots.Add(TurnComponent->InitiativeSlot);
+	}
+	TurnComponent->InitiativeSlot = INDEX_NONE;
+
 	if (CurrentComponent == TurnComponent)
 	{
 		CurrentComponent = nullptr;
-		bStartNewTurn = true;
+		ScheduleTurnTransition();
 	}
 	if (NextComponent == TurnComponent)
 	{
@@ -107,7 +266,7 @@ void ATurnManager::EndTurn(UTurnComponent *Ender)
 {
 	if (Ender == CurrentComponent)
 	{
-		bStartNewTurn = true;
+		ScheduleTurnTransition();
 	}
 	else
 	{
@@ -126,14 +285,16 @@ void ATurnManager::EndTeamTurn(FGenericTeamId InTeamId)
 {
 	if (CurrentComponent->TeamId() == InTeamId)
 	{
-		TArray<UTurnComponent *> TeamMemebers;
-		Teams.MultiFind(InTeamId, TeamMemebers);
-		for (UTurnComponent *Member : TeamMemebers)
+		FTurnManagerTeam *Team = FindTeam(InTeamId);
+		if (Team)
 		{
-			Member->RemainingActionPoints = 0;
+			for (UTurnComponent *Member : Team->Members)
+			{
+				Member->RemainingActionPoints = 0;
+			}
 		}
 
-		bStartNewTurn = true;
+		ScheduleTurnTransition();
 	}
 }
 
@@ -142,7 +303,7 @@ void ATurnManager::RequestStartTurn(UTurnComponent * CallingComponent)
 	if (!IsValid(CurrentComponent) || CurrentComponent->TeamId() == CallingComponent->TeamId())
 	{
 		NextComponent = CallingComponent;
-		bStartNewTurn = true;
+		ScheduleTurnTransition();
 	}
 }
 
@@ -154,7 +315,7 @@ void ATurnManager::RequestStartNextComponent(UTurnComponent *CallingComponent)
 		if (IsValid(Candidate))
 		{
 			NextComponent = Candidate;
-			bStartNewTurn = true;
+			ScheduleTurnTransition();
 		}
 	}
 }
@@ -169,15 +330,32 @@ AActor *ATurnManager::GetCurrentActor() const
 	return IsValid(CurrentComponent) ? CurrentComponent->GetOwner() : nullptr;
 }
 
+FTurnManagerTeam *ATurnManager::FindTeam(const FGenericTeamId &TeamId)
+{
+	// there are only ever a handful of teams
+	for (FTurnManagerTeam &Team : Teams)
+	{
+		if (Team.TeamId == TeamId)
+		{
+			return &Team;
+		}
+	}
+	return nullptr;
+}
+
 UTurnComponent * ATurnManager::FindNextTeamMember(const FGenericTeamId & TeamId)
 {
-	TArray<UTurnComponent *> TeamMembers;
-	Teams.MultiFind(TeamId, TeamMembers, true);
-	int32 StartIndex;
-	TeamMembers.Find(CurrentComponent, StartIndex);
-	for (int32 Idx = 1; Idx <= TeamMembers.Num(); Idx++)
+	FTurnManagerTeam *Team = FindTeam(TeamId);
+	return Team ? FindNextTeamMember(*Team) : nullptr;
+}
+
+UTurnComponent *ATurnManager::FindNextTeamMember(const FTurnManagerTeam &Team) const
+{
+	// start right after the member that had the last turn. Usually that one can act, so this rarely loops
+	const int32 NumMembers = Team.Members.Num();
+	for (int32 Idx = 1; Idx <= NumMembers; Idx++)
 	{
-		UTurnComponent *Candidate = TeamMembers[(StartIndex + Idx) % TeamMembers.Num()];
+		UTurnComponent *Candidate = Team.Members[(Team.Cursor + Idx) % NumMembers];
 		if (Candidate->RemainingActionPoints > 0)
 		{
 			return Candidate;
@@ -188,12 +366,14 @@ UTurnComponent * ATurnManager::FindNextTeamMember(const FGenericTeamId & TeamId)
 
 UTurnComponent * ATurnManager::FindNextComponent()
 {
-	TArray<FGenericTeamId> TeamIds;
-	Teams.GenerateKeyArray(TeamIds);
-	TeamIds.Sort();
-	for (FGenericTeamId &TeamId : TeamIds)
+	if (TurnOrder == ETurnOrder::Initiative)
+	{
+		return FindNextInitiative();
+	}
+
+	for (const FTurnManagerTeam &Team : Teams)
 	{
-		UTurnComponent *Candidate = FindNextTeamMember(TeamId);
+		UTurnComponent *Candidate = FindNextTeamMember(Team);
 		if (IsValid(Candidate))
 		{
 			return Candidate;
@@ -203,16 +383,30 @@ UTurnComponent * ATurnManager::FindNextComponent()
 	return nullptr;
 }
 
-bool ATurnManager::HasComponentsThatCanAct()
+UTurnComponent *ATurnManager::FindNextInitiative()
 {
-	for (TPair<FGenericTeamId, UTurnComponent *> &Pair : Teams)
+	while (!InitiativeQueue.IsEmpty())
 	{
-		if (Pair.Value->RemainingActionPoints > 0)
+		UTurnComponent *Candidate = InitiativeSlots[InitiativeQueue.Peek()];
+		if (IsValid(Candidate))
 		{
-			return true;
+			return Candidate;
 		}
+		InitiativeQueue.Pop();
 	}
+	return nullptr;
+}
 
-	return false;
+void ATurnManager::RequeueInitiative(UTurnComponent &Component)
+{
+	if (Component.InitiativeSlot != INDEX_NONE)
+	{
+		Component.InitiativeTime = FMath::Max(Component.InitiativeTime, InitiativeClock) + 1 / FMath::Max(Component.Speed, KINDA_SMALL_NUMBER);
+		InitiativeQueue.Push(Component.InitiativeSlot, Component.InitiativeTime);
+	}
 }
 
+bool ATurnManager::HasComponentsThatCanAct()
+{
+	return IsValid(FindNextComponent());
+}